@@ -0,0 +1,476 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <thread>
+#include <cmath>
+
+using namespace cg;
+
+const uint32_t BVH::NONE;
+
+namespace
+{
+	const uint32_t MAX_LEAF_SIZE  = 4;    // spheres per leaf (unless they can not be split)
+	const int      BINS           = 16;
+	const uint32_t PARALLEL_SIZE  = 4096; // smaller subtrees are built by the thread that split them
+
+	float area(const glm::vec3& min, const glm::vec3& max)
+	{
+		glm::vec3 e = glm::max(max - min, glm::vec3(0.0f));
+		return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+	}
+
+	// entry and exit distance of the ray into the box, false if it misses
+	bool slabs(const BVH::Node& node, const glm::vec3& origin, const glm::vec3& inverse, float maxT, float& t)
+	{
+		glm::vec3 t0 = (node.min - origin) * inverse;
+		glm::vec3 t1 = (node.max - origin) * inverse;
+		glm::vec3 near = glm::min(t0, t1);
+		glm::vec3 far  = glm::max(t0, t1);
+		float enter = glm::max(glm::max(near.x, near.y), glm::max(near.z, 0.0f));
+		float exit  = glm::min(glm::min(far.x, far.y), glm::min(far.z, maxT));
+		t = enter;
+		return enter <= exit;
+	}
+}
+
+BVH::BVH(void)
+: used(0)
+{
+}
+
+void BVH::build(const std::vector<glm::vec4>& input, bool parallel)
+{
+	uint32_t n = uint32_t(input.size());
+
+	spheres = input;
+	ids.resize(n);
+	for (uint32_t i = 0; i < n; i++)
+	{
+		ids[i] = i;
+	}
+
+	// a binary tree with n leaves has 2n - 1 nodes, children are allocated in pairs
+	nodes.assign(n > 0 ? 2 * n - 1 : 1, Node());
+	nodes[0].first = 0;
+	nodes[0].count = n;
+	used = 1;
+
+	// one level of threads per doubling of the hardware threads
+	int parallelDepth = 0;
+	for (unsigned threads = std::thread::hardware_concurrency(); parallel && threads > 1; threads >>= 1)
+	{
+		parallelDepth++;
+	}
+
+	if (n > 0)
+	{
+		subdivide(0, 0, parallelDepth);
+	}
+	else
+	{
+		nodes[0].min = nodes[0].max = glm::vec3(0.0f);
+	}
+
+	nodes.resize(used);
+	link();
+}
+
+void BVH::link(void)
+{
+	parents.assign(nodes.size(), NONE);
+	leaves.assign(spheres.size(), NONE);
+	for (uint32_t i = 0; i < nodes.size(); i++)
+	{
+		const Node& node = nodes[i];
+		if (node.count > 0)
+		{
+			for (uint32_t k = node.first; k < node.first + node.count; k++)
+			{
+				leaves[ids[k]] = i;
+			}
+		}
+		else if (node.first > 0)
+		{
+			parents[node.first] = parents[node.first + 1] = i;
+		}
+	}
+}
+
+void BVH::fit(Node& node) const
+{
+	node.min = glm::vec3( 1.0e30f);
+	node.max = glm::vec3(-1.0e30f);
+	for (uint32_t i = node.first; i < node.first + node.count; i++)
+	{
+		const glm::vec4& sphere = spheres[ids[i]];
+		node.min = glm::min(node.min, glm::vec3(sphere) - sphere.w);
+		node.max = glm::max(node.max, glm::vec3(sphere) + sphere.w);
+	}
+}
+
+void BVH::subdivide(uint32_t index, int depth, int parallelDepth)
+{
+	Node& node = nodes[index];
+	fit(node);
+
+	if (node.count <= MAX_LEAF_SIZE)
+	{
+		return;
+	}
+
+	glm::vec3 cmin( 1.0e30f);
+	glm::vec3 cmax(-1.0e30f);
+	for (uint32_t i = node.first; i < node.first + node.count; i++)
+	{
+		cmin = glm::min(cmin, glm::vec3(spheres[ids[i]]));
+		cmax = glm::max(cmax, glm::vec3(spheres[ids[i]]));
+	}
+
+	// binned SAH: cost of every bin boundary on every axis
+	int   bestAxis  = -1;
+	int   bestSplit = 0;
+	float bestCost  = float(node.count) * area(node.min, node.max); // as a leaf
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = cmax[axis] - cmin[axis];
+		if (extent <= 0.0f)
+		{
+			continue;
+		}
+		float scale = BINS / extent;
+
+		uint32_t  count[BINS] = { 0 };
+		glm::vec3 bmin[BINS];
+		glm::vec3 bmax[BINS];
+		for (int b = 0; b < BINS; b++)
+		{
+			bmin[b] = glm::vec3( 1.0e30f);
+			bmax[b] = glm::vec3(-1.0e30f);
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; i++)
+		{
+			const glm::vec4& sphere = spheres[ids[i]];
+			int b = std::min(BINS - 1, int((sphere[axis] - cmin[axis]) * scale));
+			count[b]++;
+			bmin[b] = glm::min(bmin[b], glm::vec3(sphere) - sphere.w);
+			bmax[b] = glm::max(bmax[b], glm::vec3(sphere) + sphere.w);
+		}
+
+		// sweep from the right, then from the left
+		float rightCost[BINS];
+		uint32_t n = 0;
+		glm::vec3 lo( 1.0e30f), hi(-1.0e30f);
+		for (int b = BINS - 1; b > 0; b--)
+		{
+			n += count[b];
+			lo = glm::min(lo, bmin[b]);
+			hi = glm::max(hi, bmax[b]);
+			rightCost[b] = n > 0 ? float(n) * area(lo, hi) : 0.0f;
+		}
+
+		n = 0;
+		lo = glm::vec3( 1.0e30f);
+		hi = glm::vec3(-1.0e30f);
+		for (int b = 0; b < BINS - 1; b++)
+		{
+			n += count[b];
+			lo = glm::min(lo, bmin[b]);
+			hi = glm::max(hi, bmax[b]);
+			float cost = (n > 0 ? float(n) * area(lo, hi) : 0.0f) + rightCost[b + 1];
+			if (n > 0 && n < node.count && cost < bestCost)
+			{
+				bestCost  = cost;
+				bestAxis  = axis;
+				bestSplit = b + 1;
+			}
+		}
+	}
+
+	uint32_t first = node.first;
+	uint32_t count = node.count;
+	uint32_t* begin = ids.data() + first;
+	uint32_t* end   = begin + count;
+	uint32_t* mid;
+
+	if (bestAxis >= 0)
+	{
+		float scale = BINS / (cmax[bestAxis] - cmin[bestAxis]);
+		mid = std::partition(begin, end, [&](uint32_t id)
+		{
+			return std::min(BINS - 1, int((spheres[id][bestAxis] - cmin[bestAxis]) * scale)) < bestSplit;
+		});
+	}
+	else
+	{
+		// SAH prefers a leaf: only split very large leaves (e.g. identical centers) at the median
+		if (count <= 4 * MAX_LEAF_SIZE)
+		{
+			return;
+		}
+		glm::vec3 extent = cmax - cmin;
+		int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+		mid = begin + count / 2;
+		std::nth_element(begin, mid, end, [&](uint32_t a, uint32_t b) { return spheres[a][axis] < spheres[b][axis]; });
+	}
+
+	uint32_t leftCount = uint32_t(mid - begin);
+	uint32_t left = used.fetch_add(2);
+
+	nodes[left].first     = first;
+	nodes[left].count     = leftCount;
+	nodes[left + 1].first = first + leftCount;
+	nodes[left + 1].count = count - leftCount;
+
+	if (depth < parallelDepth && count >= PARALLEL_SIZE)
+	{
+		std::thread thread(&BVH::subdivide, this, left, depth + 1, parallelDepth);
+		subdivide(left + 1, depth + 1, parallelDepth);
+		thread.join();
+	}
+	else
+	{
+		subdivide(left,     depth + 1, parallelDepth);
+		subdivide(left + 1, depth + 1, parallelDepth);
+	}
+
+	// nodes was not resized, the reference is still valid
+	node.first = left;
+	node.count = 0;
+	node.min = glm::min(nodes[left].min, nodes[left + 1].min);
+	node.max = glm::max(nodes[left].max, nodes[left + 1].max);
+}
+
+void BVH::refit(const std::vector<glm::vec4>& moved)
+{
+	spheres = moved;
+
+	// children have larger indices: one pass from the back
+	for (size_t i = nodes.size(); i-- > 0; )
+	{
+		Node& node = nodes[i];
+
+		if (node.count > 0)
+		{
+			fit(node);
+		}
+		else if (node.first > 0)
+		{
+			node.min = glm::min(nodes[node.first].min, nodes[node.first + 1].min);
+			node.max = glm::max(nodes[node.first].max, nodes[node.first + 1].max);
+		}
+	}
+}
+
+void BVH::refit(const std::vector<uint32_t>& moved, const std::vector<glm::vec4>& input)
+{
+	for (uint32_t id : moved)
+	{
+		spheres[id] = input[id];
+	}
+
+	for (uint32_t id : moved)
+	{
+		uint32_t index = leaves[id];
+		fit(nodes[index]);
+
+		// the ancestors only depend on the boxes of their children
+		while (parents[index] != NONE)
+		{
+			index = parents[index];
+			Node& node = nodes[index];
+			glm::vec3 min = glm::min(nodes[node.first].min, nodes[node.first + 1].min);
+			glm::vec3 max = glm::max(nodes[node.first].max, nodes[node.first + 1].max);
+			if (min == node.min && max == node.max)
+			{
+				break;
+			}
+			node.min = min;
+			node.max = max;
+		}
+	}
+}
+
+void BVH::collect(uint32_t index, std::vector<uint32_t>& out) const
+{
+	const Node& node = nodes[index];
+
+	if (node.count > 0)
+	{
+		out.insert(out.end(), ids.begin() + node.first, ids.begin() + node.first + node.count);
+	}
+	else if (node.first > 0)
+	{
+		collect(node.first, out);
+		collect(node.first + 1, out);
+	}
+}
+
+void BVH::cull(const Frustum& frustum, std::vector<uint32_t>& visible) const
+{
+	visible.clear();
+
+	if (ids.empty())
+	{
+		return;
+	}
+
+	std::vector<uint32_t> stack(1, 0);
+
+	while (!stack.empty())
+	{
+		uint32_t index = stack.back();
+		stack.pop_back();
+
+		const Node& node = nodes[index];
+		bool inside  = true;
+		bool outside = false;
+
+		for (int p = 0; p < 6 && !outside; p++)
+		{
+			// box corners farthest along and against the plane normal
+			const glm::vec4& plane = frustum.plane(p);
+			glm::vec3 n(plane);
+			glm::vec3 positive(n.x >= 0.0f ? node.max.x : node.min.x, n.y >= 0.0f ? node.max.y : node.min.y, n.z >= 0.0f ? node.max.z : node.min.z);
+			glm::vec3 negative(n.x >= 0.0f ? node.min.x : node.max.x, n.y >= 0.0f ? node.min.y : node.max.y, n.z >= 0.0f ? node.min.z : node.max.z);
+
+			outside = glm::dot(n, positive) + plane.w < 0.0f;
+			inside  = inside && glm::dot(n, negative) + plane.w >= 0.0f;
+		}
+
+		if (outside)
+		{
+			continue;
+		}
+
+		if (inside)
+		{
+			// the whole subtree is visible, no more tests
+			collect(index, visible);
+		}
+		else if (node.count > 0)
+		{
+			// the box intersects the frustum, test the spheres themselves
+			for (uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				const glm::vec4& sphere = spheres[ids[i]];
+				if (frustum.isVisible(glm::vec3(sphere), sphere.w))
+				{
+					visible.push_back(ids[i]);
+				}
+			}
+		}
+		else
+		{
+			stack.push_back(node.first);
+			stack.push_back(node.first + 1);
+		}
+	}
+}
+
+BVH::Hit BVH::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxT) const
+{
+	Hit hit = { NONE, maxT };
+
+	if (ids.empty())
+	{
+		return hit;
+	}
+
+	glm::vec3 d = glm::normalize(direction);
+	glm::vec3 inverse = 1.0f / d; // infinite components are handled by the slab test
+
+	std::vector<std::pair<uint32_t, float>> stack; // node, entry distance
+	float t;
+	if (slabs(nodes[0], origin, inverse, hit.t, t))
+	{
+		stack.push_back({ 0, t });
+	}
+
+	while (!stack.empty())
+	{
+		auto entry = stack.back();
+		stack.pop_back();
+
+		if (entry.second > hit.t)
+		{
+			continue; // a closer sphere was found after the node was pushed
+		}
+
+		const Node& node = nodes[entry.first];
+
+		if (node.count > 0)
+		{
+			for (uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				// |origin + t d - center|^2 = r^2
+				const glm::vec4& sphere = spheres[ids[i]];
+				glm::vec3 oc = origin - glm::vec3(sphere);
+				float b = glm::dot(oc, d);
+				float c = glm::dot(oc, oc) - sphere.w * sphere.w;
+				float discriminant = b * b - c;
+				if (discriminant < 0.0f)
+				{
+					continue;
+				}
+				float root = std::sqrt(discriminant);
+				float ts = -b - root >= 0.0f ? -b - root : -b + root; // origin inside: exit point
+				if (ts >= 0.0f && ts < hit.t)
+				{
+					hit.id = ids[i];
+					hit.t  = ts;
+				}
+			}
+			continue;
+		}
+
+		// nearer child on top of the stack
+		float tl, tr;
+		bool l = slabs(nodes[node.first],     origin, inverse, hit.t, tl);
+		bool r = slabs(nodes[node.first + 1], origin, inverse, hit.t, tr);
+		if (l && r)
+		{
+			uint32_t nearChild = tl <= tr ? node.first : node.first + 1;
+			uint32_t farChild  = tl <= tr ? node.first + 1 : node.first;
+			stack.push_back({ farChild, glm::max(tl, tr) });
+			stack.push_back({ nearChild, glm::min(tl, tr) });
+		}
+		else if (l)
+		{
+			stack.push_back({ node.first, tl });
+		}
+		else if (r)
+		{
+			stack.push_back({ node.first + 1, tr });
+		}
+	}
+
+	return hit;
+}
+
+size_t BVH::nodeCount(void) const
+{
+	return nodes.size();
+}
+
+int BVH::depth(void) const
+{
+	return ids.empty() ? 0 : depth(0);
+}
+
+int BVH::depth(uint32_t index) const
+{
+	const Node& node = nodes[index];
+	if (node.count > 0 || node.first == 0)
+	{
+		return 1;
+	}
+	return 1 + std::max(depth(node.first), depth(node.first + 1));
+}
+
+const std::vector<BVH::Node>& BVH::getNodes(void) const
+{
+	return nodes;
+}
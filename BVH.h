@@ -0,0 +1,80 @@
+#pragma once
+
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "Frustum.h"
+
+namespace cg
+{
+	/*
+	 Bounding volume hierarchy (axis aligned boxes) over bounding spheres, ids are the sphere indices.
+	 Build: binned SAH (16 bins per axis), subtrees are built in parallel threads.
+	 Refit: recomputes the boxes bottom up for moved spheres, the tree stays the same
+	 (rebuild once the spheres have moved far, culling and picking get slower but stay correct).
+	 With the ids of the moved spheres only the paths from their leaves to the root are refit,
+	 a path stops early at the first unchanged box.
+	 PROTOCOL
+	 this->build(spheres)        // xyz: center, w: radius
+	 this->refit(spheres)        // optional, after moving spheres (same count and order): all nodes
+	 this->refit(moved, spheres) // optional, after moving a few spheres: O(moved * depth)
+	 this->cull, this->raycast   // any number of times
+	*/
+	class BVH
+	{
+	public:
+		struct Node
+		{
+			glm::vec3 min;
+			uint32_t  first; // leaf: first entry in ids, inner node: index of the left child (right = first + 1)
+			glm::vec3 max;
+			uint32_t  count; // leaf: number of spheres, inner node: 0
+		};
+
+		struct Hit
+		{
+			uint32_t id; // sphere, NONE if nothing was hit
+			float    t;  // distance along the (normalized) ray direction
+		};
+
+		static const uint32_t NONE = 0xFFFFFFFF;
+
+		BVH(void);
+
+		void build(const std::vector<glm::vec4>& spheres, bool parallel = true);
+		void refit(const std::vector<glm::vec4>& spheres);
+		void refit(const std::vector<uint32_t>& moved, const std::vector<glm::vec4>& spheres); // ids of moved spheres
+
+		void cull(const Frustum& frustum, std::vector<uint32_t>& visible) const; // ids of the visible spheres
+		Hit  raycast(const glm::vec3& origin, const glm::vec3& direction, float maxT = 1.0e30f) const; // nearest sphere
+
+		size_t nodeCount(void) const;
+		int depth(void) const;
+		const std::vector<Node>& getNodes(void) const;
+
+	private:
+		BVH(const BVH&) = delete;
+		BVH& operator=(const BVH&) = delete;
+
+		void subdivide(uint32_t node, int depth, int parallelDepth);
+		void link(void);                                           // parents and leaves after the build
+		void fit(Node& node) const;                                // box of the spheres of a leaf
+		void collect(uint32_t node, std::vector<uint32_t>& out) const; // all ids below node
+		int  depth(uint32_t node) const;
+
+		std::vector<Node>     nodes;    // nodes[0]: root, children have larger indices than their parent
+		std::vector<uint32_t> ids;      // sphere ids, every leaf references a range
+		std::vector<glm::vec4> spheres; // copy of the input, for the sphere tests in the leaves
+		std::vector<uint32_t> parents;  // by node, NONE for the root
+		std::vector<uint32_t> leaves;   // by sphere id: its leaf node
+		std::atomic<uint32_t> used;     // allocated nodes during the build
+	};
+};
+
+#endif
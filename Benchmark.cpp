@@ -0,0 +1,835 @@
+#include "Benchmark.h"
+
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <memory>
+#include <fstream>
+#include <cstdio>
+#include <thread>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "VertexFormat.h"
+#include "UniformBuffer.h"
+#include "GLState.h"
+#include "GeometryPool.h"
+#include "Icosphere.h"
+#include "LatticeSphere.h"
+#include "MeshOptimizer.h"
+#include "VertexPacking.h"
+#include "Meshlets.h"
+#include "SoftwareRasterizer.h"
+#include "Frustum.h"
+#include "BVH.h"
+
+using namespace cg;
+
+namespace
+{
+	// File content with "#define VARIANT n" after the #version line.
+	std::string variant(const std::string& source, int n)
+	{
+		size_t line = source.find('\n') + 1;
+		return source.substr(0, line) + "#define VARIANT " + std::to_string(n) + "\n" + source.substr(line);
+	}
+
+	std::string readFile(const char* filename)
+	{
+		std::string content;
+		GLSLProgram::loadFile(filename, content);
+		return content;
+	}
+
+	// with the #includes resolved, as compileShaderFromFile passes it to the driver
+	std::string expandFile(const char* filename)
+	{
+		ShaderLibrary::Expansion expansion;
+		ShaderLibrary::shared().expand(filename, expansion);
+		return expansion.source;
+	}
+
+	// Cache statistics of one mesh before and after MeshOptimizer.
+	void optimizeMesh(const std::string& name, std::vector<uint32_t> indices, size_t vertexCount)
+	{
+		float acmr = MeshOptimizer::acmr(indices.data(), indices.size(), vertexCount);
+		float atvr = MeshOptimizer::atvr(indices.data(), indices.size(), vertexCount);
+
+		benchmark::Timer timer;
+		MeshOptimizer::optimizeVertexCache(indices, vertexCount);
+		double cacheMs = timer.ms();
+		std::vector<uint32_t> remap;
+		MeshOptimizer::optimizeVertexFetch(indices, vertexCount, remap);
+		double fetchMs = timer.ms() - cacheMs;
+
+		std::cout << "  " << name << "  " << indices.size() / 3 << " triangles  ACMR " << acmr << " -> "
+			<< MeshOptimizer::acmr(indices.data(), indices.size(), vertexCount) << "  ATVR " << atvr << " -> "
+			<< MeshOptimizer::atvr(indices.data(), indices.size(), vertexCount) << "  cache order " << cacheMs
+			<< " ms  fetch order " << fetchMs << " ms" << std::endl;
+	}
+
+	// Identity frame constants and model matrix while in scope, the application's frame constants are restored.
+	class IdentityFrame
+	{
+	public:
+		IdentityFrame(GLSLProgram& program) : previous(0)
+		{
+			glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, FrameConstants::BINDING, &previous);
+			frame.update(FrameConstants());
+			frame.bind(FrameConstants::BINDING);
+			program.bindUniformBlock("FrameConstants", FrameConstants::BINDING);
+			program.use();
+			program.setUniform("model", glm::mat4(1.0f));
+		}
+
+		~IdentityFrame(void)
+		{
+			GLState::bindBufferBase(GL_UNIFORM_BUFFER, FrameConstants::BINDING, GLuint(previous));
+		}
+
+	private:
+		UniformBuffer frame;
+		GLint previous;
+	};
+
+	// Draws the bound VAO frames times, returns GPU and CPU time per frame in ms.
+	void timeDraws(GLsizei vertexCount, int frames, double& gpu, double& cpu)
+	{
+		benchmark::GPUTimer gpuTimer;
+		benchmark::Timer cpuTimer;
+
+		gpuTimer.begin();
+		for (int i = 0; i < frames; i++)
+		{
+			glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+		}
+		gpuTimer.end();
+		glFinish();
+
+		cpu = cpuTimer.ms() / frames;
+		gpu = gpuTimer.ms() / frames;
+	}
+}
+
+void benchmark::vertexLayouts(GLSLProgram& program, size_t vertexCount, int frames)
+{
+	vertexCount -= vertexCount % 3;
+
+	// Tiny triangles scattered over the viewport: vertex fetch bound, hardly any fragments.
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<glm::vec3> positions(vertexCount);
+	std::vector<glm::vec3> colors(vertexCount);
+	for (size_t i = 0; i < vertexCount; i += 3)
+	{
+		glm::vec3 center(unit(random), unit(random), unit(random) * 0.5f);
+		positions[i]     = center;
+		positions[i + 1] = center + glm::vec3(0.002f, 0.0f, 0.0f);
+		positions[i + 2] = center + glm::vec3(0.0f, 0.002f, 0.0f);
+		colors[i] = colors[i + 1] = colors[i + 2] = center * 0.5f + 0.5f;
+	}
+
+	GLuint programId = program.getHandle();
+	GLint position = glGetAttribLocation(programId, "position");
+	GLint color    = glGetAttribLocation(programId, "color");
+
+	GLuint vao[2];
+	GLuint buffers[3];
+	glGenVertexArrays(2, vao);
+	glGenBuffers(3, buffers);
+
+	// separate: one buffer per attribute, stride 0 (inactive attributes skipped like in VertexFormat::setup)
+	GLState::bindVertexArray(vao[0]);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+	glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+	if (position >= 0)
+	{
+		glEnableVertexAttribArray(position);
+		glVertexAttribPointer(position, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	}
+	GLState::bindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+	glBufferData(GL_ARRAY_BUFFER, colors.size() * sizeof(glm::vec3), colors.data(), GL_STATIC_DRAW);
+	if (color >= 0)
+	{
+		glEnableVertexAttribArray(color);
+		glVertexAttribPointer(color, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	}
+
+	// interleaved: one buffer
+	const VertexFormat format = VertexFormat().add<glm::vec3>("position").add<glm::vec3>("color");
+	const std::vector<uint8_t> data = format.interleave(positions, colors);
+	GLState::bindVertexArray(vao[1]);
+	GLState::bindBuffer(GL_ARRAY_BUFFER, buffers[2]);
+	glBufferData(GL_ARRAY_BUFFER, data.size(), data.data(), GL_STATIC_DRAW);
+	format.setup(program);
+
+	IdentityFrame frame(program);
+
+	const char* names[2] = { "separate   ", "interleaved" };
+	std::cout << "Vertex layouts: " << vertexCount << " vertices, " << frames << " frames" << std::endl;
+	for (int layout = 0; layout < 2; layout++)
+	{
+		GLState::bindVertexArray(vao[layout]);
+		double gpu, cpu;
+		timeDraws(GLsizei(vertexCount), 2, gpu, cpu); // warm up
+		timeDraws(GLsizei(vertexCount), frames, gpu, cpu);
+		std::cout << "  " << names[layout] << "  gpu " << gpu << " ms/frame  cpu " << cpu << " ms/frame  "
+			<< vertexCount / gpu / 1.0e3 << " Mvertices/s" << std::endl;
+	}
+
+	GLState::bindVertexArray(0);
+	GLState::deleteBuffers(3, buffers);
+	GLState::deleteVertexArrays(2, vao);
+}
+
+void benchmark::programStartup(const char* vertexFile, const char* fragmentFile, const std::string& cacheDir, int runs)
+{
+	std::cout << "Program startup: " << vertexFile << " + " << fragmentFile << ", " << runs << " runs" << std::endl;
+	std::cout << "  renderer " << glGetString(GL_RENDERER) << std::endl;
+
+	// 0: from source, 1: with binary cache (the first run may have to fill it)
+	for (int cached = 0; cached < 2; cached++)
+	{
+		double total = 0.0;
+		double first = 0.0;
+		int hits = 0;
+
+		for (int run = 0; run < runs; run++)
+		{
+			Timer timer;
+			GLSLProgram program(false);
+			if (cached)
+			{
+				program.setBinaryCache(cacheDir);
+			}
+
+			if (!program.compileShaderFromFile(vertexFile, GLSLShader::VERTEX) ||
+				!program.compileShaderFromFile(fragmentFile, GLSLShader::FRAGMENT) ||
+				!program.link())
+			{
+				std::cout << "  failed: " << program.log() << std::endl;
+				return;
+			}
+
+			double ms = timer.ms();
+			total += ms;
+			first = run == 0 ? ms : first;
+			hits += program.isFromBinaryCache() ? 1 : 0;
+		}
+
+		std::cout << (cached ? "  binary cache" : "  source      ") << "  first " << first << " ms  average "
+			<< total / runs << " ms  cache hits " << hits << "/" << runs << std::endl;
+	}
+}
+
+void benchmark::programCompile(const char* vertexFile, const char* fragmentFile, int count)
+{
+	const std::string vertex   = expandFile(vertexFile);
+	const std::string fragment = expandFile(fragmentFile);
+
+	bool threads = GLSLProgram::setCompilerThreads();
+	std::cout << "Program compile: " << count << " variants of " << vertexFile << " + " << fragmentFile
+		<< (threads ? ", parallel shader compile" : ", no parallel shader compile extension") << std::endl;
+
+	// variants of the second pass differ from the first as well
+	for (int async = 0; async < 2; async++)
+	{
+		std::vector<std::unique_ptr<GLSLProgram>> programs;
+		Timer timer;
+
+		for (int i = 0; i < count; i++)
+		{
+			int n = async * count + i;
+			programs.emplace_back(new GLSLProgram(false));
+			programs.back()->setAsync(async != 0);
+			programs.back()->compileShaderFromString(variant(vertex, n), GLSLShader::VERTEX);
+			programs.back()->compileShaderFromString(variant(fragment, n), GLSLShader::FRAGMENT);
+			programs.back()->link();
+		}
+		double submit = timer.ms();
+
+		int failed = 0;
+		for (auto& program : programs)
+		{
+			failed += program->wait() ? 0 : 1;
+		}
+
+		std::cout << (async ? "  async " : "  serial") << "  submit " << submit << " ms  total " << timer.ms()
+			<< " ms  failed " << failed << std::endl;
+	}
+}
+
+void benchmark::shaderLoad(const char* filename, size_t megabytes, int runs)
+{
+	const std::string source = readFile(filename);
+	if (source.empty())
+	{
+		std::cout << "Shader load: could not read " << filename << std::endl;
+		return;
+	}
+
+	const std::string large = std::string(filename) + ".large";
+	{
+		std::ofstream file(large, std::ios::binary);
+		for (size_t written = 0; written < megabytes << 20; written += source.size())
+		{
+			file << source;
+		}
+	}
+
+	std::cout << "Shader load: " << large << ", " << megabytes << " MB, " << runs << " runs" << std::endl;
+
+	double lines = 0.0;
+	double single = 0.0;
+	size_t size[2] = { 0, 0 };
+	for (int run = 0; run < runs; run++)
+	{
+		// the former compileShaderFromFile
+		Timer timer;
+		std::fstream file(large);
+		std::string line;
+		std::string content;
+		while (!file.eof())
+		{
+			getline(file, line);
+			content += line + "\n";
+		}
+		file.close();
+		lines += timer.ms();
+		size[0] = content.size();
+
+		Timer timer2;
+		GLSLProgram::loadFile(large.c_str(), content);
+		single += timer2.ms();
+		size[1] = content.size();
+	}
+
+	std::cout << "  getline   " << lines / runs << " ms  " << size[0] << " bytes" << std::endl;
+	std::cout << "  loadFile  " << single / runs << " ms  " << size[1] << " bytes" << std::endl;
+
+	std::remove(large.c_str());
+}
+
+void benchmark::geometryPool(GLSLProgram& program, size_t objects, int frames)
+{
+	// icosphere levels 0..4 as separate meshes, scattered small spheres
+	const int LEVELS = 5;
+	const Icosphere& icosphere = Icosphere::shared(LEVELS - 1);
+	const VertexFormat format = VertexFormat().add<glm::vec3>("position").add<glm::vec3>("color");
+	const VertexFormat instanceFormat = VertexFormat().add<glm::vec4>("instance");
+
+	std::vector<glm::vec3> colors;
+	for (const glm::vec3& p : icosphere.getVertices())
+	{
+		colors.push_back(p * 0.5f + 0.5f);
+	}
+	const std::vector<uint8_t> vertices = format.interleave(icosphere.getVertices(), colors);
+
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<glm::vec4> instances(objects);
+	std::vector<size_t> meshOf(objects);
+	for (size_t i = 0; i < objects; i++)
+	{
+		instances[i] = glm::vec4(unit(random), unit(random), unit(random), 0.01f);
+		meshOf[i] = i % LEVELS; // consecutive objects never share a mesh
+	}
+
+	// per object: own VAO, vertex and index buffer, the instance attribute is a constant
+	GLint instance = glGetAttribLocation(program.getHandle(), "instance");
+	GLuint vao[LEVELS];
+	GLuint buffers[2 * LEVELS];
+	glGenVertexArrays(LEVELS, vao);
+	glGenBuffers(2 * LEVELS, buffers);
+	for (int level = 0; level < LEVELS; level++)
+	{
+		const Icosphere::Level& range = icosphere.level(level);
+		GLState::bindVertexArray(vao[level]);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, buffers[2 * level]);
+		glBufferData(GL_ARRAY_BUFFER, range.vertexCount * format.getStride(), vertices.data(), GL_STATIC_DRAW);
+		format.setup(program);
+		GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[2 * level + 1]);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, range.indexCount * sizeof(GLuint),
+			&icosphere.getIndices()[range.firstIndex], GL_STATIC_DRAW);
+	}
+
+	// pool: the levels share the vertices of the largest one
+	GeometryPool pool(format, instanceFormat);
+	GLint base = pool.addVertices(vertices.data(), icosphere.getVertices().size());
+	for (int level = 0; level < LEVELS; level++)
+	{
+		const Icosphere::Level& range = icosphere.level(level);
+		pool.addMesh(base, GLuint(range.vertexCount), &icosphere.getIndices()[range.firstIndex], range.indexCount);
+	}
+	pool.upload(program);
+
+	IdentityFrame frame(program);
+	std::cout << "Geometry pool: " << objects << " objects, " << LEVELS << " meshes, " << frames << " frames" << std::endl;
+
+	for (int mode = 0; mode < 2; mode++)
+	{
+		GPUTimer gpuTimer;
+		Timer cpuTimer;
+		gpuTimer.begin();
+		for (int f = 0; f < frames; f++)
+		{
+			if (mode == 0)
+			{
+				for (size_t i = 0; i < objects; i++)
+				{
+					const Icosphere::Level& range = icosphere.level(int(meshOf[i]));
+					GLState::bindVertexArray(vao[meshOf[i]]);
+					glVertexAttrib4fv(instance, &instances[i].x);
+					glDrawElements(GL_TRIANGLES, GLsizei(range.indexCount), GL_UNSIGNED_INT, nullptr);
+				}
+			}
+			else
+			{
+				pool.begin();
+				for (size_t i = 0; i < objects; i++)
+				{
+					pool.draw(meshOf[i], instances[i]);
+				}
+				pool.flush();
+			}
+		}
+		gpuTimer.end();
+		glFinish();
+		std::cout << (mode ? "  pool (multi draw indirect)" : "  per object                ") << "  gpu " << gpuTimer.ms() / frames
+			<< " ms/frame  cpu " << cpuTimer.ms() / frames << " ms/frame" << std::endl;
+	}
+
+	GLState::bindVertexArray(0);
+	GLState::deleteBuffers(2 * LEVELS, buffers);
+	GLState::deleteVertexArrays(LEVELS, vao);
+}
+
+void benchmark::frustumCulling(size_t objects, int runs)
+{
+	// camera at the origin looking down -z, most objects are outside
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> unit(-50.0f, 50.0f);
+	BoundingSpheres spheres;
+	for (size_t i = 0; i < objects; i++)
+	{
+		spheres.add(glm::vec3(unit(random), unit(random), unit(random)), 0.5f);
+	}
+	Frustum frustum(glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f));
+
+	std::vector<uint32_t> visible;
+	std::cout << "Frustum culling: " << objects << " spheres, " << runs << " runs" << std::endl;
+
+	for (int simd = 0; simd < 2; simd++)
+	{
+		Timer timer;
+		for (int run = 0; run < runs; run++)
+		{
+			if (simd)
+			{
+				spheres.cull(frustum, visible);
+			}
+			else
+			{
+				spheres.cullScalar(frustum, visible);
+			}
+		}
+		std::cout << (simd ? "  simd  " : "  scalar") << "  " << timer.ms() / runs << " ms  visible "
+			<< visible.size() << std::endl;
+	}
+}
+
+void benchmark::boundingVolumeHierarchy(int runs)
+{
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> unit(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> jitter(-0.1f, 0.1f);
+	Frustum frustum(glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f));
+
+	for (size_t objects = 10000; objects <= 1000000; objects *= 10)
+	{
+		std::vector<glm::vec4> spheres(objects);
+		BoundingSpheres linear;
+		for (glm::vec4& sphere : spheres)
+		{
+			sphere = glm::vec4(unit(random), unit(random), unit(random), 0.5f);
+			linear.add(glm::vec3(sphere), sphere.w);
+		}
+
+		std::cout << "BVH: " << objects << " spheres, " << runs << " runs" << std::endl;
+
+		BVH bvh;
+		for (int parallel = 0; parallel < 2; parallel++)
+		{
+			Timer timer;
+			bvh.build(spheres, parallel != 0);
+			std::cout << (parallel ? "  build parallel" : "  build serial  ") << "  " << timer.ms() << " ms  nodes "
+				<< bvh.nodeCount() << "  depth " << bvh.depth() << std::endl;
+		}
+
+		for (size_t i = 0; i < objects; i++)
+		{
+			spheres[i] += glm::vec4(jitter(random), jitter(random), jitter(random), 0.0f);
+			linear.set(i, glm::vec3(spheres[i]), spheres[i].w);
+		}
+		{
+			Timer timer;
+			bvh.refit(spheres);
+			std::cout << "  refit           " << timer.ms() << " ms" << std::endl;
+		}
+
+		// 1% of the spheres move again, only their paths are refit
+		std::vector<uint32_t> moved;
+		for (size_t i = 0; i < objects; i += 100)
+		{
+			spheres[i] += glm::vec4(jitter(random), jitter(random), jitter(random), 0.0f);
+			linear.set(i, glm::vec3(spheres[i]), spheres[i].w);
+			moved.push_back(uint32_t(i));
+		}
+		{
+			Timer timer;
+			bvh.refit(moved, spheres);
+			std::cout << "  refit 1%        " << timer.ms() << " ms" << std::endl;
+		}
+
+		std::vector<uint32_t> visible;
+		for (int tree = 0; tree < 2; tree++)
+		{
+			Timer timer;
+			for (int run = 0; run < runs; run++)
+			{
+				if (tree)
+				{
+					bvh.cull(frustum, visible);
+				}
+				else
+				{
+					linear.cull(frustum, visible);
+				}
+			}
+			std::cout << (tree ? "  cull bvh      " : "  cull linear   ") << "  " << timer.ms() / runs << " ms  visible "
+				<< visible.size() << std::endl;
+		}
+
+		// rays from the camera through random points on the far plane
+		const int rays = 1000;
+		size_t hits = 0;
+		Timer timer;
+		for (int i = 0; i < rays; i++)
+		{
+			glm::vec3 target(unit(random) * 0.8f, unit(random) * 0.6f, -100.0f);
+			hits += bvh.raycast(glm::vec3(0.0f), target).id != BVH::NONE;
+		}
+		std::cout << "  raycast         " << timer.ms() * 1000.0 / rays << " us  hits " << hits << "/" << rays << std::endl;
+	}
+}
+
+void benchmark::icosphereBuild(int maxLevel)
+{
+	size_t triangles = 0;
+	for (int n = 0; n <= maxLevel; n++)
+	{
+		triangles += size_t(20) << (2 * n);
+	}
+	std::cout << "Icosphere build: levels 0.." << maxLevel << ", " << triangles << " triangles" << std::endl;
+
+	Icosphere serial;
+	unsigned hardware = std::max(std::thread::hardware_concurrency(), 1u);
+
+	for (unsigned threads = 1; ; threads = std::min(2 * threads, hardware))
+	{
+		Icosphere parallel;
+		Icosphere& icosphere = threads == 1 ? serial : parallel; // the first run is the reference
+		Timer timer;
+		icosphere.build(maxLevel, threads);
+		double ms = timer.ms();
+
+		bool same = icosphere.getIndices() == serial.getIndices() &&
+			std::equal(serial.getVertices().begin(), serial.getVertices().end(), icosphere.getVertices().begin(), icosphere.getVertices().end());
+
+		double perSecond = triangles / (ms / 1000.0);
+		std::cout << "  " << threads << " threads  " << ms << " ms  " << perSecond / 1.0e6 << " Mtriangles/s  "
+			<< perSecond / threads / 1.0e6 << " Mtriangles/s per thread" << (same ? "" : "  DIFFERS FROM SERIAL") << std::endl;
+
+		if (threads == hardware)
+		{
+			break;
+		}
+	}
+}
+
+void benchmark::sphereGeneration(int maxLevel)
+{
+	std::cout << "Sphere generation: levels 0.." << maxLevel << std::endl;
+
+	for (int level = 0; level <= maxLevel; level++)
+	{
+		Icosphere icosphere;
+		Timer subdivision;
+		icosphere.build(level, 1);
+		double subdivisionMs = subdivision.ms();
+
+		// the same levels, every one generated on its own into preallocated arrays
+		std::vector<glm::vec3> vertices(LatticeSphere::vertexCount(1 << level));
+		std::vector<uint32_t>  indices(LatticeSphere::indexCount(1 << level));
+		Timer lattice;
+		for (int n = 0; n <= level; n++)
+		{
+			LatticeSphere::generate(1 << n, vertices.data(), indices.data());
+		}
+		double latticeMs = lattice.ms();
+
+		std::cout << "  level " << level << "  " << icosphere.level(level).indexCount / 3 << " triangles  subdivision "
+			<< subdivisionMs << " ms  lattice " << latticeMs << " ms" << std::endl;
+	}
+}
+
+void benchmark::vertexCache(int maxLevel)
+{
+	std::cout << "Vertex cache: " << MeshOptimizer::CACHE_SIZE << " entries" << std::endl;
+
+	const Icosphere& icosphere = Icosphere::shared(maxLevel);
+	for (int level = 1; level <= maxLevel; level += 2)
+	{
+		const Icosphere::Level& range = icosphere.level(level);
+		const std::vector<uint32_t>& indices = icosphere.getIndices();
+		optimizeMesh("icosphere " + std::to_string(level), std::vector<uint32_t>(indices.begin() + range.firstIndex,
+			indices.begin() + range.firstIndex + range.indexCount), range.vertexCount);
+
+		std::vector<glm::vec3> vertices(LatticeSphere::vertexCount(1 << level));
+		std::vector<uint32_t>  lattice(LatticeSphere::indexCount(1 << level));
+		LatticeSphere::generate(1 << level, vertices.data(), lattice.data());
+		optimizeMesh("lattice   " + std::to_string(level), lattice, vertices.size());
+	}
+
+	// like fghGenerateSphere: slices + 1 vertices per stack, quads stack after stack
+	const int slices = 256, stacks = 128;
+	std::vector<uint32_t> rows;
+	for (int i = 0; i < stacks; i++)
+	{
+		for (int j = 0; j < slices; j++)
+		{
+			uint32_t a = i * (slices + 1) + j;
+			uint32_t b = a + slices + 1;
+			const uint32_t quad[6] = { a, b, a + 1,   a + 1, b, b + 1 };
+			rows.insert(rows.end(), quad, quad + 6);
+		}
+	}
+	optimizeMesh("stacks/slices", rows, size_t(stacks + 1) * (slices + 1));
+}
+
+void benchmark::vertexPacking(size_t vertices, int runs)
+{
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<glm::vec3> normals(vertices);
+	std::vector<glm::vec3> colors(vertices);
+	for (size_t i = 0; i < vertices; i++)
+	{
+		normals[i] = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 1.0e-3f));
+		colors[i]  = normals[i] * 0.5f + 0.5f;
+	}
+	const VertexPacking::Bounds bounds = VertexPacking::bounds(normals.data(), vertices);
+
+	std::vector<glm::u16vec4> positions(vertices);
+	std::vector<glm::i16vec2> octahedral(vertices);
+	std::vector<glm::u8vec4>  rgba(vertices);
+
+	std::cout << "Vertex packing: " << vertices << " vertices, " << runs << " runs, 36 -> 16 bytes" << std::endl;
+
+	for (int batch = 0; batch < 2; batch++)
+	{
+		const char* names[] = { "unorm16 position", "half position   ", "octahedral      ", "unorm8 color    " };
+		for (int attribute = 0; attribute < 4; attribute++)
+		{
+			Timer timer;
+			for (int run = 0; run < runs; run++)
+			{
+				if (batch)
+				{
+					switch (attribute)
+					{
+					case 0: VertexPacking::packPositions(normals.data(), vertices, bounds, positions.data()); break;
+					case 1: VertexPacking::packPositionsHalf(normals.data(), vertices, positions.data()); break;
+					case 2: VertexPacking::packNormals(normals.data(), vertices, octahedral.data()); break;
+					case 3: VertexPacking::packColors(colors.data(), vertices, rgba.data()); break;
+					}
+					continue;
+				}
+
+				const glm::vec3 scale = 1.0f / bounds.scale();
+				for (size_t i = 0; i < vertices; i++)
+				{
+					switch (attribute)
+					{
+					case 0: { glm::uint64 p = glm::packUnorm4x16(glm::vec4((normals[i] - bounds.min) * scale, 0.0f)); std::memcpy(static_cast<void*>(&positions[i]), &p, sizeof(p)); break; }
+					case 1: { glm::uint64 p = glm::packHalf4x16(glm::vec4(normals[i], 1.0f)); std::memcpy(static_cast<void*>(&positions[i]), &p, sizeof(p)); break; }
+					case 2: { glm::uint32 p = glm::packSnorm2x16(VertexPacking::octahedral(normals[i])); std::memcpy(static_cast<void*>(&octahedral[i]), &p, sizeof(p)); break; }
+					case 3: { glm::uint32 p = glm::packUnorm4x8(glm::vec4(colors[i], 1.0f)); std::memcpy(static_cast<void*>(&rgba[i]), &p, sizeof(p)); break; }
+					}
+				}
+			}
+			double ms = timer.ms() / runs;
+			std::cout << (batch ? "  batch " : "  glm   ") << names[attribute] << "  " << ms << " ms  "
+				<< vertices / (ms * 1000.0) << " Mvertices/s" << std::endl;
+		}
+	}
+
+	// error of the batch results
+	float maxAngle = 0.0f;
+	for (size_t i = 0; i < vertices; i++)
+	{
+		glm::vec3 n = VertexPacking::octahedralDecode(glm::max(glm::vec2(octahedral[i]) / 32767.0f, -1.0f));
+		maxAngle = glm::max(maxAngle, std::acos(glm::min(glm::dot(n, normals[i]), 1.0f)));
+	}
+	std::cout << "  max. normal error " << glm::degrees(maxAngle) << " degrees" << std::endl;
+}
+
+void benchmark::meshletCulling(int level, int cameras)
+{
+	const Icosphere& icosphere = Icosphere::shared(level);
+	const Icosphere::Level& range = icosphere.level(level);
+	const glm::vec3* positions = icosphere.getVertices().data();
+	std::vector<uint32_t> indices(icosphere.getIndices().begin() + range.firstIndex,
+		icosphere.getIndices().begin() + range.firstIndex + range.indexCount);
+	const size_t triangles = indices.size() / 3;
+	float acmr = MeshOptimizer::acmr(indices.data(), indices.size(), range.vertexCount);
+
+	Meshlets meshlets;
+	Timer timer;
+	meshlets.add(indices.data(), indices.size(), positions, range.vertexCount);
+	double buildMs = timer.ms();
+
+	size_t vertices = 0;
+	for (size_t i = 0; i < meshlets.size(); i++)
+	{
+		vertices += meshlets.meshlet(i).vertexCount;
+	}
+	std::cout << "Meshlets: icosphere " << level << ", " << triangles << " triangles, " << meshlets.size() << " meshlets, "
+		<< double(vertices) / meshlets.size() << " vertices and " << double(triangles) / meshlets.size()
+		<< " triangles each, build " << buildMs << " ms, ACMR " << acmr << " -> "
+		<< MeshOptimizer::acmr(indices.data(), indices.size(), range.vertexCount) << std::endl;
+
+	// cameras 1.5 to 5 radii from the center looking at the sphere
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> distance(1.5f, 5.0f);
+	const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+	std::vector<glm::vec3> eyes;
+	std::vector<Frustum> frustums;
+	for (int c = 0; c < cameras; c++)
+	{
+		glm::vec3 eye = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 1.0e-3f)) * distance(random);
+		eyes.push_back(eye);
+		frustums.push_back(Frustum(projection * glm::lookAt(eye, glm::vec3(unit(random), unit(random), unit(random)) * 0.5f, glm::vec3(0.0f, 1.0f, 0.0f))));
+	}
+
+	size_t inFrustum = 0, drawn = 0, backFacing = 0, wrong = 0;
+	std::vector<GeometryPool::DrawCommand> commands;
+	for (int c = 0; c < cameras; c++)
+	{
+		for (size_t i = 0; i < meshlets.size(); i++)
+		{
+			const Meshlets::Meshlet& meshlet = meshlets.meshlet(i);
+			inFrustum += frustums[c].isVisible(meshlet.center, meshlet.radius) ? meshlet.triangleCount : 0;
+			bool culled = Meshlets::isBackFacing(meshlet, eyes[c]);
+			for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+			{
+				const uint32_t* triangle = &indices[meshlet.firstIndex + 3 * t];
+				glm::vec3 n = glm::cross(positions[triangle[1]] - positions[triangle[0]], positions[triangle[2]] - positions[triangle[0]]);
+				bool back = glm::dot(n, positions[triangle[0]] - eyes[c]) >= 0.0f;
+				backFacing += back;
+				wrong += culled && !back;
+			}
+		}
+		commands.clear();
+		meshlets.cull(0, frustums[c], eyes[c], commands);
+		for (const GeometryPool::DrawCommand& command : commands)
+		{
+			drawn += command.count / 3;
+		}
+	}
+	std::cout << "  triangles drawn: all " << triangles << ", frustum culling " << double(inFrustum) / cameras
+		<< ", frustum and cone culling " << double(drawn) / cameras << " (" << double(backFacing) / cameras
+		<< " back-facing), front-facing triangles culled " << wrong << std::endl;
+
+	for (int simd = 0; simd < 2; simd++)
+	{
+		Timer cullTimer;
+		for (int c = 0; c < cameras; c++)
+		{
+			commands.clear();
+			if (simd)
+			{
+				meshlets.cull(0, frustums[c], eyes[c], commands);
+			}
+			else
+			{
+				meshlets.cullScalar(0, frustums[c], eyes[c], commands);
+			}
+		}
+		std::cout << (simd ? "  simd  " : "  scalar") << "  " << cullTimer.ms() * 1000.0 / cameras << " us per camera" << std::endl;
+	}
+}
+
+void benchmark::softwareRasterizer(int width, int height, int grid, int frames, const char* filename)
+{
+	const int level = 4;
+	const Icosphere& icosphere = Icosphere::shared(level);
+	const Icosphere::Level& range = icosphere.level(level);
+	const std::vector<glm::vec3>& positions = icosphere.getVertices();
+	std::vector<glm::vec3> colors;
+	for (const glm::vec3& p : positions)
+	{
+		colors.push_back(p * 0.5f + 0.5f);
+	}
+	const std::vector<uint16_t> indices(icosphere.getIndices().begin() + range.firstIndex,
+		icosphere.getIndices().begin() + range.firstIndex + range.indexCount);
+
+	const glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), float(width) / float(height), 0.1f, 100.0f)
+		* glm::lookAt(glm::vec3(1.0f, 1.5f, 4.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	std::vector<glm::mat4> models;
+	const float spacing = 3.0f / grid;
+	for (int z = 0; z < grid; z++)
+	{
+		for (int y = 0; y < grid; y++)
+		{
+			for (int x = 0; x < grid; x++)
+			{
+				glm::vec3 center = (glm::vec3(x, y, z) + 0.5f) * spacing - 1.5f;
+				models.push_back(glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(0.4f * spacing)));
+			}
+		}
+	}
+
+	std::cout << "Software rasterizer: " << width << "x" << height << ", " << models.size() << " spheres, "
+		<< models.size() * indices.size() / 3 << " triangles, " << frames << " frames" << std::endl;
+
+	SoftwareRasterizer rasterizer(width, height);
+	unsigned hardware = std::max(std::thread::hardware_concurrency(), 1u);
+	for (unsigned threads = 1; ; threads = std::min(2 * threads, hardware))
+	{
+		rasterizer.setThreads(threads);
+		Timer timer;
+		for (int frame = 0; frame < frames; frame++)
+		{
+			rasterizer.clear(glm::vec3(0.2f));
+			for (const glm::mat4& model : models)
+			{
+				rasterizer.draw(viewProjection * model, positions.data(), colors.data(), range.vertexCount, indices.data(), indices.size());
+			}
+			rasterizer.finish();
+		}
+		double ms = timer.ms() / frames;
+		const SoftwareRasterizer::Statistics& statistics = rasterizer.getStatistics();
+		std::cout << "  " << threads << " threads  " << ms << " ms/frame  " << statistics.triangles / (ms * 1000.0) << " Mtriangles/s  "
+			<< statistics.fragments / (ms * 1000.0) << " Mpixels/s  (" << statistics.rasterized << " triangles, "
+			<< statistics.fragments << " pixels rasterized)" << std::endl;
+
+		if (threads == hardware)
+		{
+			break;
+		}
+	}
+	rasterizer.writePPM(filename);
+}
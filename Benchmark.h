@@ -0,0 +1,117 @@
+#pragma once
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <iostream>
+#include <chrono>
+
+#include <GL/glew.h>
+
+#include "GLSLProgram.h"
+
+namespace cg
+{
+	/*
+	 Simple timers and benchmarks. Results are written to std::cout.
+	 The GL benchmarks need a current context and change GL state (VAO, program, viewport content).
+	*/
+	namespace benchmark
+	{
+		/*
+		 CPU wall clock timer.
+		*/
+		class Timer
+		{
+		public:
+			Timer(void) : start(std::chrono::high_resolution_clock::now()) {}
+
+			double ms(void) const
+			{
+				return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			}
+
+		private:
+			std::chrono::high_resolution_clock::time_point start;
+		};
+
+		/*
+		 GPU timer (GL_TIME_ELAPSED query), begin/end must not be nested.
+		*/
+		class GPUTimer
+		{
+		public:
+			GPUTimer(void)  { glGenQueries(1, &query); }
+			~GPUTimer(void) { glDeleteQueries(1, &query); }
+
+			void begin(void) { glBeginQuery(GL_TIME_ELAPSED, query); }
+			void end(void)   { glEndQuery(GL_TIME_ELAPSED); }
+
+			double ms(void) const // waits for the result
+			{
+				GLuint64 ns = 0;
+				glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+				return ns / 1.0e6;
+			}
+
+		private:
+			GLuint query;
+		};
+
+		// Separate position/color buffers vs. one interleaved buffer, vertexCount small triangles.
+		// The program needs the attributes "position", "color", the uniform "model" and the FrameConstants block.
+		void vertexLayouts(GLSLProgram& program, size_t vertexCount = 3000000, int frames = 50);
+
+		// Startup cost of a program (compile + link) from source vs. from the program binary cache.
+		// Without a window: --headless 1 --bench-startup (CMake option HEADLESS, e.g. with Mesa llvmpipe).
+		void programStartup(const char* vertexFile, const char* fragmentFile, const std::string& cacheDir, int runs = 10);
+
+		// count variants of a program compiled one after another vs. all submitted first (GLSLProgram::setAsync).
+		// Every variant gets its own #define so the driver cannot reuse an earlier compile.
+		void programCompile(const char* vertexFile, const char* fragmentFile, int count = 32);
+
+		// Loading a shader file of about megabytes size (the file repeated, as after #include expansion):
+		// getline + append vs. GLSLProgram::loadFile. Writes a temporary file next to the original.
+		void shaderLoad(const char* filename, size_t megabytes = 16, int runs = 5);
+
+		// objects small spheres (5 icosphere levels): one VAO bind + draw per object vs. one GeometryPool
+		// glMultiDrawElementsIndirect. The program is the one of shader/instanced.vert.
+		void geometryPool(GLSLProgram& program, size_t objects = 20000, int frames = 20);
+
+		// CPU only: objects random bounding spheres around the camera, scalar vs. SIMD frustum test.
+		void frustumCulling(size_t objects = 1000000, int runs = 20);
+
+		// CPU only: BVH over 10^4, 10^5, 10^6 random spheres. Serial vs. parallel build, refit of all
+		// and of 1% of the spheres, BVH vs. linear SIMD culling, ray picking.
+		void boundingVolumeHierarchy(int runs = 20);
+
+		// CPU only: Icosphere levels 0..maxLevel built with 1, 2, 4, .. hardware threads,
+		// triangles per second and a check that every result equals the serial one.
+		void icosphereBuild(int maxLevel = 9);
+
+		// CPU only: levels 0..maxLevel by repeated subdivision with an edge-midpoint map (Icosphere,
+		// one thread) vs. LatticeSphere with frequencies 1, 2, 4, .. 2^maxLevel.
+		void sphereGeneration(int maxLevel = 9);
+
+		// CPU only: ACMR and ATVR (16 entry FIFO) before and after MeshOptimizer for Icosphere and
+		// LatticeSphere levels up to maxLevel and a stacks/slices sphere in the freeglut index order.
+		void vertexCache(int maxLevel = 7);
+
+		// CPU only: packing vertices random unit vectors as positions, normals and colors,
+		// one glm/gtc/packing.hpp call per vertex vs. the VertexPacking batch routines.
+		void vertexPacking(size_t vertices = 4000000, int runs = 10);
+
+		// CPU only: Meshlets of an Icosphere level, seen by cameras around the sphere: triangles left
+		// after frustum culling alone and with the normal cones, scalar vs. SIMD culling time, and a
+		// check that no meshlet with a front-facing triangle is culled.
+		void meshletCulling(int level = 7, int cameras = 1000);
+
+		// CPU only: grid^3 Icosphere spheres (16 bit indices) rendered by SoftwareRasterizer at
+		// width x height with 1, 2, 4, .. hardware threads, Mtriangles/s and Mpixels/s (covered
+		// pixels). The image of the last run is written to filename.
+		void softwareRasterizer(int width = 1920, int height = 1080, int grid = 10, int frames = 5,
+			const char* filename = "software.ppm");
+	};
+};
+
+#endif
@@ -0,0 +1,152 @@
+#include "Frustum.h"
+
+#include <glm/simd/common.h>
+
+using namespace cg;
+
+Frustum::Frustum(void)
+{
+	update(glm::mat4(1.0f));
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+	update(viewProjection);
+}
+
+void Frustum::update(const glm::mat4& m)
+{
+	// Gribb/Hartmann: rows of the (column major) matrix
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; i++)
+	{
+		row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+	}
+
+	planes[0] = row[3] + row[0]; // left
+	planes[1] = row[3] - row[0]; // right
+	planes[2] = row[3] + row[1]; // bottom
+	planes[3] = row[3] - row[1]; // top
+	planes[4] = row[3] + row[2]; // near
+	planes[5] = row[3] - row[2]; // far
+
+	for (glm::vec4& plane : planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+}
+
+bool Frustum::isVisible(const glm::vec3& center, float radius) const
+{
+	for (const glm::vec4& plane : planes)
+	{
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+const glm::vec4& Frustum::plane(int i) const
+{
+	return planes[i];
+}
+
+BoundingSpheres::BoundingSpheres(void)
+: count(0)
+{
+}
+
+size_t BoundingSpheres::add(const glm::vec3& center, float radius)
+{
+	if (count == x.size())
+	{
+		x.resize(count + 4, 0.0f);
+		y.resize(count + 4, 0.0f);
+		z.resize(count + 4, 0.0f);
+		r.resize(count + 4, 0.0f);
+	}
+
+	set(count, center, radius);
+	return count++;
+}
+
+void BoundingSpheres::set(size_t id, const glm::vec3& center, float radius)
+{
+	x[id] = center.x;
+	y[id] = center.y;
+	z[id] = center.z;
+	r[id] = radius;
+}
+
+void BoundingSpheres::clear(void)
+{
+	x.clear();
+	y.clear();
+	z.clear();
+	r.clear();
+	count = 0;
+}
+
+size_t BoundingSpheres::size(void) const
+{
+	return count;
+}
+
+void BoundingSpheres::cullScalar(const Frustum& frustum, std::vector<uint32_t>& visible) const
+{
+	visible.clear();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (frustum.isVisible(glm::vec3(x[i], y[i], z[i]), r[i]))
+		{
+			visible.push_back(uint32_t(i));
+		}
+	}
+}
+
+void BoundingSpheres::cull(const Frustum& frustum, std::vector<uint32_t>& visible) const
+{
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+	visible.clear();
+
+	glm_vec4 planes[6][4]; // broadcast plane components
+	for (int p = 0; p < 6; p++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			planes[p][c] = _mm_set1_ps(frustum.plane(p)[c]);
+		}
+	}
+
+	for (size_t i = 0; i < count; i += 4)
+	{
+		glm_vec4 px = _mm_loadu_ps(&x[i]);
+		glm_vec4 py = _mm_loadu_ps(&y[i]);
+		glm_vec4 pz = _mm_loadu_ps(&z[i]);
+		glm_vec4 nr = glm_vec4_sub(_mm_setzero_ps(), _mm_loadu_ps(&r[i]));
+
+		// bit k set: sphere i + k is not outside any plane tested so far
+		int inside = 0xF;
+		for (int p = 0; p < 6 && inside; p++)
+		{
+			glm_vec4 d = glm_vec4_fma(px, planes[p][0], planes[p][3]);
+			d = glm_vec4_fma(py, planes[p][1], d);
+			d = glm_vec4_fma(pz, planes[p][2], d);
+			inside &= ~_mm_movemask_ps(_mm_cmplt_ps(d, nr));
+		}
+
+		for (int k = 0; k < 4; k++)
+		{
+			if ((inside & (1 << k)) && i + k < count)
+			{
+				visible.push_back(uint32_t(i + k));
+			}
+		}
+	}
+#else
+	cullScalar(frustum, visible);
+#endif
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+namespace cg
+{
+	/*
+	 View frustum as 6 normalized planes (left, right, bottom, top, near, far) extracted from
+	 projection * view (or projection * view * model for model space tests).
+	 A point p is inside if dot(plane.xyz, p) + plane.w >= 0 for all planes.
+	*/
+	class Frustum
+	{
+	public:
+		Frustum(void);
+		explicit Frustum(const glm::mat4& viewProjection);
+
+		void update(const glm::mat4& viewProjection);
+
+		bool isVisible(const glm::vec3& center, float radius) const; // sphere not completely outside a plane
+		const glm::vec4& plane(int i) const;
+
+	private:
+		glm::vec4 planes[6];
+	};
+
+	/*
+	 Bounding spheres in SoA layout (x, y, z, radius arrays) for culling many objects at once:
+	 with SSE2 (GLM_ARCH_SSE2_BIT, glm/simd) four spheres are tested against a plane per instruction.
+	 PROTOCOL
+	 this->add, this->set     // one sphere per object, the id is the index
+	 this->cull               // every frame, ids of the visible spheres in ascending order
+	*/
+	class BoundingSpheres
+	{
+	public:
+		BoundingSpheres(void);
+
+		size_t add(const glm::vec3& center, float radius);
+		void set(size_t id, const glm::vec3& center, float radius);
+		void clear(void);
+		size_t size(void) const;
+
+		void cull(const Frustum& frustum, std::vector<uint32_t>& visible) const;       // SIMD if available
+		void cullScalar(const Frustum& frustum, std::vector<uint32_t>& visible) const; // reference
+
+	private:
+		// padded to a multiple of 4, padding is never reported visible
+		std::vector<float> x, y, z, r;
+		size_t count;
+	};
+};
+
+#endif
@@ -1,5 +1,17 @@
 #include "GLSLProgram.h"
 
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "GLState.h"
+
 using namespace cg;
 
 std::map<GLSLShader::GLSLShaderType, std::string> GLSLShader::GLSLShaderTypeString = {
@@ -12,9 +24,14 @@ std::map<GLSLShader::GLSLShaderType, std::string> GLSLShader::GLSLShaderTypeStri
 
 GLSLProgram::GLSLProgram(bool verbose)
 : handle(0)
-, linked(false)
 , logString("")
+, linked(false)
+, async(false)
+, pending(false)
 , verbose(verbose)
+, echoSource(false)
+, uniformStats()
+, fromBinaryCache(false)
 {
 }
 
@@ -29,7 +46,7 @@ GLSLProgram::~GLSLProgram(void)
 	shaders.clear();
 
 	// Delete program
-	glDeleteProgram(handle);
+	GLState::deleteProgram(handle);
 	handle = 0;
 }
 
@@ -51,11 +68,12 @@ bool GLSLProgram::checkAndCreateProgram(void)
 
 bool GLSLProgram::compileShaderFromFile(const char* filename, GLSLShader::GLSLShaderType type)
 {
-	std::fstream file(filename);
+	// #include expansion, included files are read and parsed once per process
+	ShaderLibrary::Expansion expansion;
 
-	if (!file.good())
+	if (!ShaderLibrary::shared().expand(filename, expansion))
 	{
-		logString = "could not open file \"" + std::string(filename) + "\"";
+		logString = ShaderLibrary::shared().log();
 		return false;
 	}
 	
@@ -64,22 +82,45 @@ bool GLSLProgram::compileShaderFromFile(const char* filename, GLSLShader::GLSLSh
 		return false;
 	}
 
-	std::string line;
-	std::string content;
+	if (echoSource) {
+		std::cerr << "[" << GLSLShader::GLSLShaderTypeString[type] << "]" << std::endl 
+			<< expansion.source << std::endl;
+	}
 
-	while (!file.eof())
+	if (!compileSource(expansion.source, type, expansion.hash))
 	{
-		getline(file, line);
-		content += line + "\n";
+		// the log refers to source string numbers
+		for (size_t i = 1; i < expansion.files.size(); i++)
+		{
+			logString += "source " + std::to_string(i) + ": " + expansion.files[i] + "\n";
+		}
+		return false;
 	}
 
-	file.close();
-	if (verbose) {
-		std::cerr << "[" << GLSLShader::GLSLShaderTypeString[type] << "]" << std::endl 
-			<< content << std::endl;
+	return true;
+}
+
+bool GLSLProgram::loadFile(const char* filename, std::string& content)
+{
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+
+	if (!file.good())
+	{
+		return false;
 	}
 
-	return compileShaderFromString(content, type);
+	std::streamsize size = file.tellg();
+
+	if (size < 0)
+	{
+		return false;
+	}
+
+	content.resize(size_t(size));
+	file.seekg(0);
+	file.read(&content[0], size);
+
+	return file.good() || size == 0;
 }
 
 bool GLSLProgram::compileShaderFromString(const std::string& source, GLSLShader::GLSLShaderType type)
@@ -88,7 +129,25 @@ bool GLSLProgram::compileShaderFromString(const std::string& source, GLSLShader:
 	{
 		return false;
 	}
-	
+
+	return compileSource(source, type, binaryCacheDir.empty() ? 0 : hash(source.data(), source.size()));
+}
+
+bool GLSLProgram::compileSource(const std::string& source, GLSLShader::GLSLShaderType type, uint64_t sourceHash)
+{
+	if (!binaryCacheDir.empty())
+	{
+		// compiled in link(), unless the program binary is cached
+		Source deferred = { type, source, sourceHash };
+		sources.push_back(deferred);
+		return true;
+	}
+
+	return compileShader(source, type);
+}
+
+bool GLSLProgram::compileShader(const std::string& source, GLSLShader::GLSLShaderType type)
+{
 	GLuint shader = glCreateShader(type);
 
 	if (shader == 0)
@@ -99,10 +158,24 @@ bool GLSLProgram::compileShaderFromString(const std::string& source, GLSLShader:
 
 	shaders.push_back(shader);
 
-	const GLchar* codeArray[]= {source.c_str()};
-	glShaderSource (shader, 1, codeArray, nullptr);
+	// explicit length: no strlen over the source in the driver
+	const GLchar* codeArray[] = {source.data()};
+	const GLint   lengths[]   = {GLint(source.size())};
+	glShaderSource (shader, 1, codeArray, lengths);
 	glCompileShader(shader);
+	glAttachShader(handle, shader); // does not wait for the compiler
 
+	// asynchronous: the status is checked in wait()
+	if (!async && !checkShader(shader))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool GLSLProgram::checkShader(GLuint shader)
+{
 	GLint result;
 	glGetShaderiv(shader, GL_COMPILE_STATUS, &result);
 
@@ -124,8 +197,6 @@ bool GLSLProgram::compileShaderFromString(const std::string& source, GLSLShader:
 		return false;
 	}
 
-	glAttachShader(handle, shader);
-
 	return true;
 }
 
@@ -136,27 +207,159 @@ bool GLSLProgram::link(void)
 		return true;
 	}
 
+	if (pending)
+	{
+		return wait();
+	}
+
 	if (handle < 1)
 	{
 		return false;
 	}
 
+	fromBinaryCache = false;
+	pendingBinaryPath.clear();
+
+	if (!sources.empty())
+	{
+		// binary cache: load the program binary, or compile, link and store it
+		std::string path = binaryCachePath();
+
+		if (loadBinary(path))
+		{
+			sources.clear();
+			fromBinaryCache = true;
+			linked = true;
+			reflectUniforms();
+
+			return true;
+		}
+
+		for (const auto& source : sources)
+		{
+			if (!compileShader(source.text, source.type))
+			{
+				return false;
+			}
+		}
+
+		sources.clear();
+		glProgramParameteri(handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		pendingBinaryPath = path;
+	}
+
 	glLinkProgram(handle);
+	pending = true;
+
+	return async ? true : wait();
+}
+
+GLSLProgram::Future GLSLProgram::linkAsync(void)
+{
+	bool enabled = async;
+	async = true;
+	link();
+	async = enabled;
+
+	return Future(*this);
+}
 
+void GLSLProgram::setAsync(bool enabled)
+{
+	async = enabled;
+}
+
+bool GLSLProgram::isReady(void) const
+{
+	if (!pending)
+	{
+		return true;
+	}
+
+	if (GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile)
+	{
+		GLint done;
+		glGetProgramiv(handle, GL_COMPLETION_STATUS_KHR, &done);
+		return done == GL_TRUE;
+	}
+
+	// no way to ask without blocking, wait() will block
+	return true;
+}
+
+bool GLSLProgram::wait(void)
+{
+	if (!pending)
+	{
+		return linked;
+	}
+
+	pending = false;
+
+	if (!checkLink())
+	{
+		// a failed compile is the usual reason, its log is more helpful
+		for (GLuint shader : shaders)
+		{
+			if (!checkShader(shader))
+			{
+				break;
+			}
+		}
+
+		return false;
+	}
+
+	if (!pendingBinaryPath.empty())
+	{
+		saveBinary(pendingBinaryPath);
+		pendingBinaryPath.clear();
+	}
+
+	linked = true;
+	reflectUniforms();
+
+	return true;
+}
+
+void GLSLProgram::setEchoSource(bool enabled)
+{
+	echoSource = enabled;
+}
+
+bool GLSLProgram::setCompilerThreads(GLuint count)
+{
+	if (GLEW_KHR_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsKHR(count);
+		return true;
+	}
+
+	if (GLEW_ARB_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsARB(count);
+		return true;
+	}
+
+	return false;
+}
+
+bool GLSLProgram::checkLink(void)
+{
 	GLint result;
 	glGetProgramiv(handle, GL_LINK_STATUS, &result);
 
 	if (result == GL_FALSE)
 	{
 		GLint logLen;
-		glGetShaderiv(handle, GL_INFO_LOG_LENGTH, &logLen);
+		glGetProgramiv(handle, GL_INFO_LOG_LENGTH, &logLen);
 		
 		if (logLen > 0)
 		{
 			char* log = new char[logLen];
 
 			GLsizei written;
-			glGetShaderInfoLog(handle, logLen, &written, log);
+			glGetProgramInfoLog(handle, logLen, &written, log);
 			logString = std::string(log);
 			delete [] log;
 		}
@@ -164,19 +367,142 @@ bool GLSLProgram::link(void)
 		return false;
 	}
 
-	linked = true;
-
 	return true;
 }
 
+void GLSLProgram::setBinaryCache(const std::string& directory)
+{
+	binaryCacheDir = directory;
+}
+
+bool GLSLProgram::isFromBinaryCache(void) const
+{
+	return fromBinaryCache;
+}
+
+uint64_t GLSLProgram::hash(const void* data, size_t size, uint64_t seed)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	for (size_t i = 0; i < size; i++)
+	{
+		seed = (seed ^ bytes[i]) * 1099511628211ull;
+	}
+
+	return seed;
+}
+
+std::string GLSLProgram::binaryCachePath(void) const
+{
+	// A binary is only valid for the same driver: renderer, vendor and version are part of the key.
+	uint64_t key = hash(nullptr, 0);
+	const GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+
+	for (GLenum name : strings)
+	{
+		const char* value = reinterpret_cast<const char*>(glGetString(name));
+		if (value)
+		{
+			key = hash(value, strlen(value), key);
+		}
+	}
+
+	for (const auto& source : sources)
+	{
+		// hash of the source instead of the source: the include expansion already computed it
+		key = hash(&source.type, sizeof(source.type), key);
+		key = hash(&source.hash, sizeof(source.hash), key);
+	}
+
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long) key);
+
+	return binaryCacheDir + "/" + name;
+}
+
+bool GLSLProgram::loadBinary(const std::string& path)
+{
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+	if (glProgramBinary == nullptr || formats < 1)
+	{
+		return false;
+	}
+
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+	if (!file.good())
+	{
+		return false;
+	}
+
+	std::streamsize size = file.tellg();
+	GLenum format = 0;
+
+	if (size <= std::streamsize(sizeof(format)))
+	{
+		return false;
+	}
+
+	std::vector<char> binary(size_t(size) - sizeof(format));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(&format), sizeof(format));
+	file.read(binary.data(), binary.size());
+
+	if (!file.good())
+	{
+		return false;
+	}
+
+	glProgramBinary(handle, format, binary.data(), GLsizei(binary.size()));
+
+	// rejected by the driver (e.g. after an update): fall back to compiling
+	GLint result;
+	glGetProgramiv(handle, GL_LINK_STATUS, &result);
+
+	return result == GL_TRUE;
+}
+
+void GLSLProgram::saveBinary(const std::string& path)
+{
+	GLint length = 0;
+	glGetProgramiv(handle, GL_PROGRAM_BINARY_LENGTH, &length);
+
+	if (glGetProgramBinary == nullptr || length < 1)
+	{
+		return;
+	}
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(handle, length, &length, &format, binary.data());
+
+#ifdef _WIN32
+	_mkdir(binaryCacheDir.c_str());
+#else
+	mkdir(binaryCacheDir.c_str(), 0755);
+#endif
+
+	// a missing cache file only costs a compile next time, errors are ignored
+	std::ofstream file(path, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+	file.write(binary.data(), length);
+}
+
 void GLSLProgram::use(void)
 {
+	if (pending)
+	{
+		wait();
+	}
+
 	if (handle < 1 || !linked)
 	{
 		return;
 	}
 
-	glUseProgram(handle);
+	GLState::useProgram(handle);
 }
 
 std::string GLSLProgram::log(void) const
@@ -204,98 +530,124 @@ void GLSLProgram::bindFragDataLocation(GLuint location, const char* name)
 	glBindFragDataLocation(handle, location, name);
 }
 
-void GLSLProgram::setUniform(const char* name, float x, float y, float z)
+bool GLSLProgram::bindUniformBlock(const char* name, GLuint binding)
 {
-	int location = getUniformLocation(name);
+	if (pending)
+	{
+		wait();
+	}
 
-	if (location < 0)
+	if (handle < 1 || !linked)
 	{
-		if (verbose)
-			std::cout << "Uniform \"" << name << "\" not found" << std::endl;
+		return false;
 	}
-	else
+
+	GLuint index = glGetUniformBlockIndex(handle, name);
+
+	if (index == GL_INVALID_INDEX)
 	{
-		glUniform3f(location, x, y, z);
+		if (verbose)
+			std::cout << "Uniform block \"" << name << "\" not found" << std::endl;
+		return false;
 	}
+
+	glUniformBlockBinding(handle, index, binding);
+
+	return true;
+}
+
+void GLSLProgram::setUniform(const char* name, float x, float y, float z)
+{
+	setUniform(name, glm::vec3(x, y, z));
 }
 
 void GLSLProgram::setUniform(const char* name, const glm::vec3& v)
 {
-	setUniform(name, v.x, v.y, v.z);
+	Uniform* uniform = findUniform(name);
+
+	if (uniform == nullptr)
+	{
+		if (verbose)
+			std::cout << "Uniform \"" << name << "\" not found" << std::endl;
+	}
+	else if (changed(*uniform, &v, sizeof(v)))
+	{
+		glUniform3f(uniform->location, v.x, v.y, v.z);
+	}
 }
 
 void GLSLProgram::setUniform(const char* name, const glm::vec4& v)
 {
-	int location = getUniformLocation(name);
+	Uniform* uniform = findUniform(name);
 
-	if (location < 0)
+	if (uniform == nullptr)
 	{
 		if (verbose)
 			std::cout << "Uniform \"" << name << "\" not found" << std::endl;
 	}
-	else
+	else if (changed(*uniform, &v, sizeof(v)))
 	{
-		glUniform4f(location, v.x, v.y, v.z, v.w);
+		glUniform4f(uniform->location, v.x, v.y, v.z, v.w);
 	}
 }
 
 void GLSLProgram::setUniform(const char* name, const glm::mat3& m)
 {
-	int location = getUniformLocation(name);
+	Uniform* uniform = findUniform(name);
 
-	if (location < 0)
+	if (uniform == nullptr)
 	{
 		if (verbose)
 			std::cout << "Uniform \"" << name << "\" not found" << std::endl;
 	}
-	else
+	else if (changed(*uniform, &m, sizeof(m)))
 	{
-		glUniformMatrix3fv(location, 1, GL_FALSE, &m[0][0]);
+		glUniformMatrix3fv(uniform->location, 1, GL_FALSE, &m[0][0]);
 	}
 }
 
 void GLSLProgram::setUniform(const char* name, const glm::mat4& m)
 {
-	int location = getUniformLocation(name);
+	Uniform* uniform = findUniform(name);
 
-	if (location < 0)
+	if (uniform == nullptr)
 	{
 		if (verbose)
 			std::cout << "Uniform \"" << name << "\" not found" << std::endl;
 	}
-	else
+	else if (changed(*uniform, &m, sizeof(m)))
 	{
-		glUniformMatrix4fv(location, 1, GL_FALSE, &m[0][0]);
+		glUniformMatrix4fv(uniform->location, 1, GL_FALSE, &m[0][0]);
 	}
 }
 
 void GLSLProgram::setUniform(const char* name, float value)
 {
-	int location = getUniformLocation(name);
+	Uniform* uniform = findUniform(name);
 
-	if (location < 0)
+	if (uniform == nullptr)
 	{
 		if (verbose)
 			std::cout << "Uniform \"" << name << "\" not found" << std::endl;
 	}
-	else
+	else if (changed(*uniform, &value, sizeof(value)))
 	{
-		glUniform1f(location, value);
+		glUniform1f(uniform->location, value);
 	}
 }
 
 void GLSLProgram::setUniform(const char* name, int value)
 {
-	int location = getUniformLocation(name);
+	Uniform* uniform = findUniform(name);
 
-	if (location < 0)
+	if (uniform == nullptr)
 	{
 		if (verbose)
 			std::cout << "Uniform \"" << name << "\" not found" << std::endl;
 	}
-	else
+	else if (changed(*uniform, &value, sizeof(value)))
 	{
-		glUniform1i(location, value);
+		glUniform1i(uniform->location, value);
 	}
 }
 
@@ -306,21 +658,32 @@ void GLSLProgram::setUniform(const char* name, bool value)
 
 void GLSLProgram::setUniform(const char* name, int size, const glm::mat4* value)
 {
-	int location = getUniformLocation(name);
+	Uniform* uniform = findUniform(name);
 
-	if (location < 0)
+	if (uniform == nullptr)
 	{
 		if (verbose)
 			std::cout << "Uniform \"" << name << "\" not found" << std::endl;
 	}
-	else
+	else if (changed(*uniform, value, size * sizeof(glm::mat4)))
 	{
-		glUniformMatrix4fv(location, size, GL_FALSE, glm::value_ptr(value[0]));
+		glUniformMatrix4fv(uniform->location, size, GL_FALSE, glm::value_ptr(value[0]));
 	}
 }
 
 void GLSLProgram::printActiveUniforms(void)
 {
+	for (const auto& uniform : uniforms)
+	{
+		if (uniform.second.type == 0)
+		{
+			continue; // looked up by name, not from reflection
+		}
+
+		std::cout << "uniform " << uniform.first << " location " << uniform.second.location
+			<< " type 0x" << std::hex << uniform.second.type << std::dec
+			<< " size " << uniform.second.size << std::endl;
+	}
 }
 
 void GLSLProgram::printActiveAttribs(void)
@@ -329,12 +692,112 @@ void GLSLProgram::printActiveAttribs(void)
 
 int GLSLProgram::getUniformLocation(const char* name)
 {
+	Uniform* uniform = findUniform(name);
+
+	return uniform ? uniform->location : -1;
+}
+
+const GLSLProgram::UniformStats& GLSLProgram::getUniformStats(void) const
+{
+	return uniformStats;
+}
+
+void GLSLProgram::resetUniformStats(void)
+{
+	uniformStats = UniformStats();
+}
+
+void GLSLProgram::reflectUniforms(void)
+{
+	uniforms.clear();
+	resetUniformStats();
+
+	GLint count = 0;
+	GLint maxLength = 0;
+	glGetProgramiv(handle, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(handle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	std::vector<GLchar> buffer(maxLength + 1);
+	uniforms.reserve(2 * count);
+
+	for (GLint i = 0; i < count; i++)
+	{
+		GLsizei length = 0;
+		Uniform uniform;
+		glGetActiveUniform(handle, i, GLsizei(buffer.size()), &length, &uniform.size, &uniform.type, buffer.data());
+
+		std::string name(buffer.data(), length);
+		uniform.location = glGetUniformLocation(handle, name.c_str());
+
+		if (uniform.location < 0)
+		{
+			continue; // member of a uniform block
+		}
+		uniform.array = uniform.size > 1 || name.find('[') != std::string::npos;
+
+		// arrays are reported as "name[0]", they are also set by "name"
+		if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+		{
+			uniforms[name.substr(0, name.size() - 3)] = uniform;
+		}
+		uniforms[name] = uniform;
+	}
+}
+
+GLSLProgram::Uniform* GLSLProgram::findUniform(const char* name)
+{
+	if (pending)
+	{
+		wait();
+	}
+
 	if (handle < 1 || !linked)
 	{
-		return -1;
+		return nullptr;
+	}
+
+	auto it = uniforms.find(name);
+
+	if (it != uniforms.end())
+	{
+		uniformStats.hits++;
+	}
+	else
+	{
+		// not reported by reflection (e.g. "name[2]") or inactive, remember the answer as well
+		uniformStats.misses++;
+
+		Uniform uniform;
+		uniform.location = glGetUniformLocation(handle, name);
+		uniform.type     = 0;
+		uniform.size     = 1;
+		uniform.array    = std::strchr(name, '[') != nullptr;
+		it = uniforms.emplace(name, uniform).first;
 	}
 
-	return glGetUniformLocation(handle, name);
+	return it->second.location < 0 ? nullptr : &it->second;
+}
+
+bool GLSLProgram::changed(Uniform& uniform, const void* value, size_t size)
+{
+	// a cached array value would go stale on writes through the other names of its elements
+	if (uniform.array)
+	{
+		uniformStats.uploads++;
+		return true;
+	}
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(value);
+
+	if (uniform.value.size() == size && std::equal(bytes, bytes + size, uniform.value.begin()))
+	{
+		uniformStats.skipped++;
+		return false;
+	}
+
+	uniform.value.assign(bytes, bytes + size);
+	uniformStats.uploads++;
+	return true;
 }
 
 bool GLSLProgram::fileExists(const std::string& filename)
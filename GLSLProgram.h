@@ -8,12 +8,16 @@
 #include <fstream>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <cstdint>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include <GL/glew.h>
 
+#include "ShaderLibrary.h"
+
 namespace cg
 {
 	namespace GLSLShader
@@ -32,7 +36,7 @@ namespace cg
 	/*
 	 Based on https://github.com/daw42/glslcookbook.
      PROTOCOL:
-     COMPILATION
+     COMPILATION                                         // files may #include others, see ShaderLibrary
 	 this->compileShaderFromFile, this->compileShaderFromString // for vertex shader
 	 this->compileShaderFromFile, this->compileShaderFromString // for fragment shader
 	 this->compileShaderFromFile, this->compileShaderFromString // for geometry shader (optional)
@@ -44,18 +48,82 @@ namespace cg
      LINKING
 	 this->link
 
+     BINARY CACHE (optional, before COMPILATION)
+	 this->setBinaryCache(directory)                      // compile* only records the sources, link loads the
+	                                                      // program binary of an earlier run or compiles, links and stores it
+
+	 ASYNCHRONOUS (optional, before COMPILATION)
+	 GLSLProgram::setCompilerThreads                      // once per context, GL_KHR_parallel_shader_compile
+	 this->setAsync(true)                                 // compile* and link only submit, no status queries
+	 this->link, this->linkAsync                          // submit the stages of all programs first ..
+	 this->isReady, Future::ready                         // .. then poll without blocking (e.g. once per frame)
+	 this->wait, Future::get                              // status checks, false on compile/link errors
+
 	 USING
-	 this->use                                            // activate program (all bound shaders)
+	 this->bindUniformBlock                               // uniform blocks, e.g. FrameConstants (see UniformBuffer)
+
+	 this->use                                            // activate program (all bound shaders), waits for a pending link
 	*/
 	class GLSLProgram
 	{
+	public:
+		struct UniformStats
+		{
+			unsigned long hits;    // location found in the cache
+			unsigned long misses;  // location queried with glGetUniformLocation
+			unsigned long uploads; // glUniform* calls
+			unsigned long skipped; // setUniform calls with an unchanged value
+		};
+
+		/*
+		 Future-like handle of an asynchronous link, valid as long as the program.
+		*/
+		class Future
+		{
+		public:
+			explicit Future(GLSLProgram& program) : program(&program) {}
+
+			bool ready(void) const { return program->isReady(); } // never blocks
+			bool get(void) const   { return program->wait(); }    // blocks, true if linked
+
+		private:
+			GLSLProgram* program;
+		};
+
 	private:
+		struct Uniform
+		{
+			GLint  location;            // -1: not active
+			GLenum type;                // GL_FLOAT_VEC3, .. (0 if not from reflection)
+			GLint  size;                // array size
+			bool   array;               // "name", "name[0]", "name[1]", .. share locations: no value cache
+			std::vector<uint8_t> value; // last uploaded value, empty: nothing uploaded yet
+		};
+
+		struct Source
+		{
+			GLSLShader::GLSLShaderType type;
+			std::string text;
+			uint64_t hash;              // of the text, for files the ShaderLibrary expansion hash
+		};
+
 	    GLuint handle;  // id/handle of program object
 		std::string logString;       // compile log
 		std::vector<GLuint> shaders; // ids/handles of shaders
 		
 		bool linked;                 // not-linked (still compiling) or linked
+		bool async;                  // compile and link without waiting for the status
+		bool pending;                // link submitted, status not checked yet
 		bool verbose;                // simple error handling: output to console
+		bool echoSource;             // debugging: print shader sources to console
+
+		std::unordered_map<std::string, Uniform> uniforms; // by name, filled after linking
+		UniformStats uniformStats;
+
+		std::string binaryCacheDir;  // empty: no binary cache
+		std::vector<Source> sources; // deferred until link with binary cache
+		bool fromBinaryCache;        // linked from a cached program binary
+		std::string pendingBinaryPath; // store the program binary here once the pending link is done
 
 	public:
 		GLSLProgram(bool verbose = true); // simple error handling: output to console
@@ -64,6 +132,7 @@ namespace cg
 		bool compileShaderFromFile  (const char* filename, GLSLShader::GLSLShaderType type);
 		bool compileShaderFromString(const std::string& source, GLSLShader::GLSLShaderType type);
 		bool link(void);
+		Future linkAsync(void);      // link without waiting, independent of setAsync
 		void use (void);
 		
 		std::string log(void) const; // error log
@@ -72,6 +141,7 @@ namespace cg
 
 		void bindAttribLocation(GLuint location, const char* name);   // location -> attrib in
 		void bindFragDataLocation(GLuint location, const char* name); //             fragData out -> location
+		bool bindUniformBlock(const char* name, GLuint binding);      // uniform block -> buffer binding (after linking)
 		void setUniform(const char* name, float x, float y, float z);
 		void setUniform(const char* name, const glm::vec3& v);
 		void setUniform(const char* name, const glm::vec4& v);
@@ -84,10 +154,39 @@ namespace cg
 		void printActiveUniforms(void);  // Get OpenGL state: uniform
 		void printActiveAttribs (void);  // Get OpenGL state: attrib
 
-		int  getUniformLocation (const char* name); // location of uniform by name
+		int  getUniformLocation (const char* name); // location of uniform by name (cached)
+
+		const UniformStats& getUniformStats(void) const; // counters since linking or the last reset
+		void resetUniformStats(void);
+
+		void setBinaryCache(const std::string& directory); // see BINARY CACHE, empty disables it
+		bool isFromBinaryCache(void) const;                 // last link used a cached program binary
+
+		void setEchoSource(bool enabled); // print the sources of compileShaderFromFile to console
+		void setAsync(bool enabled);  // see ASYNCHRONOUS
+		bool isReady(void) const;     // true if nothing is pending or the pending link is done (never blocks)
+		bool wait(void);              // finishes a pending link, same result as a synchronous link
+
+		// Number of driver threads for parallel compiles, false without GL_KHR/ARB_parallel_shader_compile.
+		static bool setCompilerThreads(GLuint count = 0xFFFFFFFF); // default: implementation maximum
+
+		// Whole file in one read (size known up front), false if it can not be read.
+		static bool loadFile(const char* filename, std::string& content);
+
+		static uint64_t hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ull); // FNV-1a
 
 	private:
 		bool checkAndCreateProgram(void);             // sets this->handle
+		bool compileSource(const std::string& source, GLSLShader::GLSLShaderType type, uint64_t sourceHash);
+		bool compileShader(const std::string& source, GLSLShader::GLSLShaderType type); // compile and attach
+		bool checkShader(GLuint shader);              // compile status, log on error
+		bool checkLink(void);                         // link status, log on error
+		std::string binaryCachePath(void) const;      // file name from sources and driver
+		bool loadBinary(const std::string& path);
+		void saveBinary(const std::string& path);
+		void reflectUniforms(void);                   // fills this->uniforms after linking
+		Uniform* findUniform(const char* name);       // nullptr if not active
+		bool changed(Uniform& uniform, const void* value, size_t size); // stores value if it differs
 		bool fileExists(const std::string& filename); // internal for this->compileShaderFromFile
 	};
 };
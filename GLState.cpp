@@ -0,0 +1,308 @@
+#include "GLState.h"
+
+#include <iostream>
+
+using namespace cg;
+
+namespace
+{
+	const GLuint UNKNOWN = 0xFFFFFFFF;
+
+	// shadowed buffer targets and their binding queries
+	const GLenum bufferTargets[]  = { GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER,
+	                                  GL_DRAW_INDIRECT_BUFFER, GL_SHADER_STORAGE_BUFFER };
+	const GLenum bufferBindings[] = { GL_ARRAY_BUFFER_BINDING, GL_ELEMENT_ARRAY_BUFFER_BINDING, GL_UNIFORM_BUFFER_BINDING,
+	                                  GL_DRAW_INDIRECT_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER_BINDING };
+	const int BUFFER_TARGETS = sizeof(bufferTargets) / sizeof(bufferTargets[0]);
+	const int ELEMENT_ARRAY  = 1;
+
+	// shadowed texture targets
+	const GLenum textureTargets[]  = { GL_TEXTURE_2D, GL_TEXTURE_3D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_ARRAY };
+	const GLenum textureBindings[] = { GL_TEXTURE_BINDING_2D, GL_TEXTURE_BINDING_3D, GL_TEXTURE_BINDING_CUBE_MAP,
+	                                   GL_TEXTURE_BINDING_2D_ARRAY };
+	const int TEXTURE_TARGETS = sizeof(textureTargets) / sizeof(textureTargets[0]);
+	const int TEXTURE_UNITS   = 32;
+
+	struct Shadow
+	{
+		GLuint program;
+		GLuint vertexArray;
+		GLuint buffers[BUFFER_TARGETS];
+		GLenum activeTexture;
+		GLuint textures[TEXTURE_UNITS][TEXTURE_TARGETS];
+
+		Shadow(void) { reset(); }
+
+		void reset(void)
+		{
+			program       = UNKNOWN;
+			vertexArray   = UNKNOWN;
+			activeTexture = UNKNOWN;
+			for (GLuint& buffer : buffers)
+			{
+				buffer = UNKNOWN;
+			}
+			for (auto& unit : textures)
+			{
+				for (GLuint& texture : unit)
+				{
+					texture = UNKNOWN;
+				}
+			}
+		}
+	};
+
+	Shadow shadow;
+	GLState::Stats stats = {};
+
+	int slot(const GLenum* targets, int count, GLenum target)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			if (targets[i] == target)
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	GLuint query(GLenum binding)
+	{
+		GLint value = 0;
+		glGetIntegerv(binding, &value);
+		return GLuint(value);
+	}
+
+	// true if the bind can be skipped: shadow == value (and, when validating, GL agrees)
+	bool redundant(GLuint shadowed, GLuint value, GLenum binding)
+	{
+#if CG_GL_STATE_SHADOWING
+		if (shadowed != value)
+		{
+			return false;
+		}
+
+#if CG_GL_STATE_VALIDATE
+		GLuint actual = query(binding);
+		if (actual != value)
+		{
+			std::cerr << "GLState: binding 0x" << std::hex << binding << " is " << std::dec << actual
+				<< ", shadow " << value << std::endl;
+			stats.mismatches++;
+			return false;
+		}
+#else
+		(void) binding;
+#endif
+
+		stats.skipped++;
+		return true;
+#else
+		(void) shadowed; (void) value; (void) binding;
+		return false;
+#endif
+	}
+
+	int textureUnit(void)
+	{
+		if (shadow.activeTexture == UNKNOWN)
+		{
+			shadow.activeTexture = query(GL_ACTIVE_TEXTURE);
+		}
+		return int(shadow.activeTexture - GL_TEXTURE0);
+	}
+}
+
+void GLState::useProgram(GLuint program)
+{
+	if (redundant(shadow.program, program, GL_CURRENT_PROGRAM))
+	{
+		return;
+	}
+
+	glUseProgram(program);
+	shadow.program = program;
+	stats.calls++;
+}
+
+void GLState::bindVertexArray(GLuint vao)
+{
+	if (redundant(shadow.vertexArray, vao, GL_VERTEX_ARRAY_BINDING))
+	{
+		return;
+	}
+
+	glBindVertexArray(vao);
+	shadow.vertexArray = vao;
+	shadow.buffers[ELEMENT_ARRAY] = UNKNOWN; // part of the VAO
+	stats.calls++;
+}
+
+void GLState::bindBuffer(GLenum target, GLuint buffer)
+{
+	int i = slot(bufferTargets, BUFFER_TARGETS, target);
+
+	if (i >= 0 && redundant(shadow.buffers[i], buffer, bufferBindings[i]))
+	{
+		return;
+	}
+
+	glBindBuffer(target, buffer);
+	if (i >= 0)
+	{
+		shadow.buffers[i] = buffer;
+	}
+	stats.calls++;
+}
+
+void GLState::bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	// indexed bindings are not shadowed
+	glBindBufferBase(target, index, buffer);
+
+	int i = slot(bufferTargets, BUFFER_TARGETS, target);
+	if (i >= 0)
+	{
+		shadow.buffers[i] = buffer;
+	}
+	stats.calls++;
+}
+
+void GLState::activeTexture(GLenum unit)
+{
+	if (redundant(shadow.activeTexture, unit, GL_ACTIVE_TEXTURE))
+	{
+		return;
+	}
+
+	glActiveTexture(unit);
+	shadow.activeTexture = unit;
+	stats.calls++;
+}
+
+void GLState::bindTexture(GLenum target, GLuint texture)
+{
+	int i = slot(textureTargets, TEXTURE_TARGETS, target);
+	int unit = CG_GL_STATE_SHADOWING && i >= 0 ? textureUnit() : -1;
+	bool shadowed = unit >= 0 && unit < TEXTURE_UNITS;
+
+	if (shadowed && redundant(shadow.textures[unit][i], texture, textureBindings[i]))
+	{
+		return;
+	}
+
+	glBindTexture(target, texture);
+	if (shadowed)
+	{
+		shadow.textures[unit][i] = texture;
+	}
+	stats.calls++;
+}
+
+void GLState::deleteProgram(GLuint program)
+{
+	// a program in use is only flagged for deletion, its name may come back later
+	if (shadow.program == program)
+	{
+		shadow.program = UNKNOWN;
+	}
+	glDeleteProgram(program);
+}
+
+void GLState::deleteVertexArrays(GLsizei n, const GLuint* vaos)
+{
+	for (GLsizei i = 0; i < n; i++)
+	{
+		// deleting the bound VAO binds 0
+		if (vaos[i] != 0 && shadow.vertexArray == vaos[i])
+		{
+			shadow.vertexArray = 0;
+			shadow.buffers[ELEMENT_ARRAY] = UNKNOWN;
+		}
+	}
+	glDeleteVertexArrays(n, vaos);
+}
+
+void GLState::deleteBuffers(GLsizei n, const GLuint* buffers)
+{
+	for (GLsizei i = 0; i < n; i++)
+	{
+		// deleting a bound buffer binds 0
+		for (GLuint& buffer : shadow.buffers)
+		{
+			if (buffers[i] != 0 && buffer == buffers[i])
+			{
+				buffer = 0;
+			}
+		}
+	}
+	glDeleteBuffers(n, buffers);
+}
+
+void GLState::deleteTextures(GLsizei n, const GLuint* textures)
+{
+	for (GLsizei i = 0; i < n; i++)
+	{
+		for (auto& unit : shadow.textures)
+		{
+			for (GLuint& texture : unit)
+			{
+				if (textures[i] != 0 && texture == textures[i])
+				{
+					texture = 0;
+				}
+			}
+		}
+	}
+	glDeleteTextures(n, textures);
+}
+
+void GLState::invalidate(void)
+{
+	shadow.reset();
+}
+
+bool GLState::validate(void)
+{
+	bool valid = true;
+
+	auto check = [&valid](GLuint shadowed, GLenum binding)
+	{
+		if (shadowed != UNKNOWN && shadowed != query(binding))
+		{
+			std::cerr << "GLState: binding 0x" << std::hex << binding << std::dec << " differs from shadow "
+				<< shadowed << std::endl;
+			valid = false;
+		}
+	};
+
+	check(shadow.program, GL_CURRENT_PROGRAM);
+	check(shadow.vertexArray, GL_VERTEX_ARRAY_BINDING);
+	for (int i = 0; i < BUFFER_TARGETS; i++)
+	{
+		check(shadow.buffers[i], bufferBindings[i]);
+	}
+	check(shadow.activeTexture, GL_ACTIVE_TEXTURE);
+
+	if (shadow.activeTexture != UNKNOWN)
+	{
+		int unit = int(shadow.activeTexture - GL_TEXTURE0);
+		for (int i = 0; unit >= 0 && unit < TEXTURE_UNITS && i < TEXTURE_TARGETS; i++)
+		{
+			check(shadow.textures[unit][i], textureBindings[i]);
+		}
+	}
+
+	return valid;
+}
+
+const GLState::Stats& GLState::getStats(void)
+{
+	return stats;
+}
+
+void GLState::resetStats(void)
+{
+	stats = Stats();
+}
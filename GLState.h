@@ -0,0 +1,65 @@
+#pragma once
+
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <GL/glew.h>
+
+// 0: every call goes to GL unchanged
+#ifndef CG_GL_STATE_SHADOWING
+#define CG_GL_STATE_SHADOWING 1
+#endif
+
+// 1: every elided call is checked against glGet* (slow, debug builds only by default)
+#ifndef CG_GL_STATE_VALIDATE
+#ifdef NDEBUG
+#define CG_GL_STATE_VALIDATE 0
+#else
+#define CG_GL_STATE_VALIDATE 1
+#endif
+#endif
+
+namespace cg
+{
+	/*
+	 Shadow of the bound program, VAO, buffers and textures of the current context:
+	 calls that would not change a binding are not passed to GL.
+	 The GL_ELEMENT_ARRAY_BUFFER binding is VAO state and unknown after every VAO change.
+	 All code of the context has to bind through GLState, otherwise call invalidate
+	 afterwards. Objects must be deleted through GLState (names are reused by GL).
+	 PROTOCOL
+	 GLState::useProgram, GLState::bindVertexArray, GLState::bindBuffer, .. // instead of gl*
+	 GLState::deleteBuffers, ..                                           // instead of glDelete*
+	 GLState::invalidate                                                  // after foreign GL code
+	*/
+	class GLState
+	{
+	public:
+		struct Stats
+		{
+			unsigned long calls;      // binds passed to GL
+			unsigned long skipped;    // redundant binds elided
+			unsigned long mismatches; // validation: shadow differed from GL (the bind is done then)
+		};
+
+		static void useProgram(GLuint program);
+		static void bindVertexArray(GLuint vao);
+		static void bindBuffer(GLenum target, GLuint buffer);
+		static void bindBufferBase(GLenum target, GLuint index, GLuint buffer); // also binds target
+		static void activeTexture(GLenum unit);                                  // GL_TEXTURE0 + i
+		static void bindTexture(GLenum target, GLuint texture);
+
+		static void deleteProgram(GLuint program);
+		static void deleteVertexArrays(GLsizei n, const GLuint* vaos);
+		static void deleteBuffers(GLsizei n, const GLuint* buffers);
+		static void deleteTextures(GLsizei n, const GLuint* textures);
+
+		static void invalidate(void); // forget everything, the next bind of each kind goes to GL
+		static bool validate(void);   // compares all known bindings with glGet*, false on a mismatch
+
+		static const Stats& getStats(void);
+		static void resetStats(void);
+	};
+};
+
+#endif
@@ -0,0 +1,196 @@
+#include "GeometryPool.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "IndexBuffer.h"
+#include "GLState.h"
+
+using namespace cg;
+
+GeometryPool::GeometryPool(const VertexFormat& format, const VertexFormat& instanceFormat)
+: format(format)
+, instanceFormat(instanceFormat)
+, vao(0)
+, vertexBuffer(0)
+, indexBuffer(0)
+, instanceBuffer(0)
+, commandBuffer(0)
+, type(GL_UNSIGNED_INT)
+, indexBytes(0)
+{
+}
+
+GeometryPool::~GeometryPool(void)
+{
+	GLuint buffers[] = { vertexBuffer, indexBuffer, instanceBuffer, commandBuffer };
+	GLState::deleteBuffers(4, buffers);
+	GLState::deleteVertexArrays(1, &vao);
+}
+
+GLint GeometryPool::addVertices(const void* data, size_t count)
+{
+	GLint base = GLint(vertices.size() / format.getStride());
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	vertices.insert(vertices.end(), bytes, bytes + count * format.getStride());
+	return base;
+}
+
+size_t GeometryPool::addMesh(GLint baseVertex, GLuint vertexCount, const uint32_t* data, size_t count)
+{
+	Mesh mesh;
+	mesh.firstIndex  = GLuint(indices.size());
+	mesh.indexCount  = GLuint(count);
+	mesh.baseVertex  = baseVertex;
+	mesh.vertexCount = vertexCount;
+
+	indices.insert(indices.end(), data, data + count);
+	meshes.push_back(mesh);
+	return meshes.size() - 1;
+}
+
+size_t GeometryPool::add(const std::vector<uint8_t>& data, const std::vector<uint32_t>& meshIndices)
+{
+	size_t count = data.size() / format.getStride();
+	GLint base = addVertices(data.data(), count);
+	return addMesh(base, GLuint(count), meshIndices.data(), meshIndices.size());
+}
+
+void GeometryPool::upload(const GLSLProgram& program)
+{
+	// one index type for all commands: the largest mesh decides
+	GLuint maxIndex = 0;
+	for (const Mesh& mesh : meshes)
+	{
+		maxIndex = std::max(maxIndex, mesh.vertexCount > 0 ? mesh.vertexCount - 1 : 0);
+	}
+	type = IndexBuffer::selectType(maxIndex);
+	size_t size = IndexBuffer::typeSize(type);
+
+	std::vector<uint8_t> data(indices.size() * size);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		switch (type)
+		{
+		case GL_UNSIGNED_BYTE:
+			data[i] = GLubyte(indices[i]);
+			break;
+		case GL_UNSIGNED_SHORT:
+			reinterpret_cast<GLushort*>(data.data())[i] = GLushort(indices[i]);
+			break;
+		default:
+			reinterpret_cast<GLuint*>(data.data())[i] = indices[i];
+			break;
+		}
+	}
+	indexBytes = data.size();
+
+	if (vao == 0)
+	{
+		glGenVertexArrays(1, &vao);
+		glGenBuffers(1, &vertexBuffer);
+		glGenBuffers(1, &indexBuffer);
+		glGenBuffers(1, &instanceBuffer);
+		glGenBuffers(1, &commandBuffer);
+	}
+
+	GLState::bindVertexArray(vao);
+
+	GLState::bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size(), vertices.data(), GL_STATIC_DRAW);
+	format.setup(program);
+
+	GLState::bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	instanceFormat.setup(program, 0, 1);
+
+	GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.size(), data.data(), GL_STATIC_DRAW);
+
+	GLState::bindVertexArray(0);
+}
+
+void GeometryPool::begin(void)
+{
+	commands.clear();
+	instances.clear();
+}
+
+void GeometryPool::draw(size_t id, const void* instance)
+{
+	const Mesh& mesh = meshes[id];
+
+	DrawCommand command;
+	command.count         = mesh.indexCount;
+	command.instanceCount = 1;
+	command.firstIndex    = mesh.firstIndex;
+	command.baseVertex    = mesh.baseVertex;
+	command.baseInstance  = GLuint(commands.size()); // selects the instance attribute of this draw
+	commands.push_back(command);
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(instance);
+	instances.insert(instances.end(), bytes, bytes + instanceFormat.getStride());
+}
+
+void GeometryPool::flush(void)
+{
+	if (commands.empty())
+	{
+		return;
+	}
+
+	GLState::bindVertexArray(vao);
+
+	// orphan and refill, the previous frame may still be read
+	GLState::bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, instances.size(), instances.data(), GL_STREAM_DRAW);
+
+	GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawCommand), commands.data(), GL_STREAM_DRAW);
+
+	glMultiDrawElementsIndirect(GL_TRIANGLES, type, nullptr, GLsizei(commands.size()), 0);
+}
+
+void GeometryPool::drawInstanced(size_t id, GLsizei count, GLuint baseInstance) const
+{
+	const Mesh& mesh = meshes[id];
+	void* offset = reinterpret_cast<void*>(size_t(mesh.firstIndex) * IndexBuffer::typeSize(type));
+	if (baseInstance == 0)
+	{
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, GLsizei(mesh.indexCount), type, offset, count, mesh.baseVertex);
+	}
+	else
+	{
+		glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, GLsizei(mesh.indexCount), type, offset, count,
+			mesh.baseVertex, baseInstance);
+	}
+}
+
+const GeometryPool::Mesh& GeometryPool::mesh(size_t id) const
+{
+	return meshes[id];
+}
+
+size_t GeometryPool::meshCount(void) const
+{
+	return meshes.size();
+}
+
+GLenum GeometryPool::indexType(void) const
+{
+	return type;
+}
+
+size_t GeometryPool::sizeInBytes(void) const
+{
+	return vertices.size() + indexBytes;
+}
+
+GLuint GeometryPool::getVertexBuffer(void) const
+{
+	return vertexBuffer;
+}
+
+GLuint GeometryPool::getIndexBuffer(void) const
+{
+	return indexBuffer;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#ifndef GEOMETRYPOOL_H
+#define GEOMETRYPOOL_H
+
+#include <vector>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+#include "GLSLProgram.h"
+#include "VertexFormat.h"
+
+namespace cg
+{
+	/*
+	 All static meshes of one vertex format in one vertex and one index buffer, drawn with
+	 glMultiDrawElementsIndirect: one VAO bind and one draw call for any number of objects.
+	 Per-draw data (e.g. position and size of the object) comes from an instance attribute,
+	 every command uses its draw index as baseInstance.
+	 The index type is the smallest one that fits every mesh relative to its base vertex.
+
+	 PROTOCOL
+	 this->addVertices, this->addMesh // or this->add, for every mesh
+	 this->upload                     // once, creates the VAO for the program
+	 this->begin, this->draw, this->flush // every frame
+	 this->drawInstanced                  // or many instances of one mesh, with a VAO of the caller on
+	                                      // getVertexBuffer and getIndexBuffer and its own instance buffer
+	*/
+	class GeometryPool
+	{
+	public:
+		struct Mesh
+		{
+			GLuint firstIndex;  // in indices
+			GLuint indexCount;
+			GLint  baseVertex;
+			GLuint vertexCount; // indices are < vertexCount (relative to baseVertex)
+		};
+
+		// layout of glMultiDrawElementsIndirect commands
+		struct DrawCommand
+		{
+			GLuint count;
+			GLuint instanceCount;
+			GLuint firstIndex;
+			GLint  baseVertex;
+			GLuint baseInstance;
+		};
+
+		GeometryPool(const VertexFormat& format, const VertexFormat& instanceFormat);
+		~GeometryPool(void); // GL context must exist on destruction
+
+		GLint  addVertices(const void* vertices, size_t count);            // interleaved in format, returns the base vertex
+		size_t addMesh(GLint baseVertex, GLuint vertexCount, const uint32_t* indices, size_t count); // returns the mesh id
+		size_t add(const std::vector<uint8_t>& vertices, const std::vector<uint32_t>& indices);
+
+		void upload(const GLSLProgram& program);
+
+		void begin(void);
+		void draw(size_t mesh, const void* instance); // instance: one vertex of instanceFormat
+		void flush(void);                             // all draws since begin, one call
+		void drawInstanced(size_t mesh, GLsizei instances, GLuint baseInstance = 0) const; // the caller's VAO is bound
+
+		template<typename T>
+		void draw(size_t mesh, const T& instance)
+		{
+			draw(mesh, static_cast<const void*>(&instance));
+		}
+
+		const Mesh& mesh(size_t id) const;
+		size_t meshCount(void) const;
+		GLenum indexType(void) const;  // after upload
+		size_t sizeInBytes(void) const; // vertices and indices
+		GLuint getVertexBuffer(void) const;
+		GLuint getIndexBuffer(void) const;
+
+	private:
+		GeometryPool(const GeometryPool&) = delete;
+		GeometryPool& operator=(const GeometryPool&) = delete;
+
+		VertexFormat format;
+		VertexFormat instanceFormat;
+
+		std::vector<uint8_t>  vertices;
+		std::vector<uint32_t> indices;  // relative to the base vertex of their mesh
+		std::vector<Mesh>     meshes;
+
+		std::vector<DrawCommand> commands;  // of the current frame
+		std::vector<uint8_t>     instances; // one per command
+
+		GLuint vao;
+		GLuint vertexBuffer;
+		GLuint indexBuffer;
+		GLuint instanceBuffer;
+		GLuint commandBuffer;
+		GLenum type;
+		size_t indexBytes;
+	};
+};
+
+#endif
@@ -0,0 +1,290 @@
+#include "HeadlessContext.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstring>
+
+#if CG_HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#endif
+
+#include "GLState.h"
+
+using namespace cg;
+
+#if CG_HEADLESS_EGL
+namespace
+{
+	// name is a complete token of the space separated list
+	bool hasExtension(const char* extensions, const char* name)
+	{
+		const size_t length = std::strlen(name);
+		for (const char* p = extensions; p && (p = std::strstr(p, name)) != nullptr; p += length)
+		{
+			if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0'))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+#endif
+
+HeadlessContext::HeadlessContext(void)
+: display(nullptr)
+, context(nullptr)
+, surface(nullptr)
+, framebuffer(0)
+, colorBuffer(0)
+, depthBuffer(0)
+, width(0)
+, height(0)
+{
+}
+
+HeadlessContext::~HeadlessContext(void)
+{
+	destroy();
+}
+
+bool HeadlessContext::isAvailable(void)
+{
+	return CG_HEADLESS_EGL != 0;
+}
+
+bool HeadlessContext::create(int width, int height, int major, int minor, bool debug)
+{
+#if CG_HEADLESS_EGL
+	destroy();
+	if (!createContext(major, minor, debug))
+	{
+		destroy();
+		return false;
+	}
+
+	// GLEW 2.1 without GLEW_EGL loads the GL functions (glXGetProcAddress, dispatched to the
+	// current EGL context by libglvnd) and only then fails for the missing GLX display.
+	GLenum status = glewInit();
+	if (status != GLEW_OK && status != GLEW_ERROR_NO_GLX_DISPLAY)
+	{
+		std::cerr << "glewInit failed: " << glewGetErrorString(status) << std::endl;
+		destroy();
+		return false;
+	}
+	GLState::invalidate(); // new context, nothing is bound
+
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(1, &colorBuffer);
+	glGenRenderbuffers(1, &depthBuffer);
+	if (!resize(width, height))
+	{
+		destroy();
+		return false;
+	}
+	glViewport(0, 0, width, height);
+	return true;
+#else
+	(void)width; (void)height; (void)major; (void)minor; (void)debug;
+	std::cerr << "Headless rendering needs EGL, build with the CMake option HEADLESS." << std::endl;
+	return false;
+#endif
+}
+
+bool HeadlessContext::createContext(int major, int minor, bool debug)
+{
+#if CG_HEADLESS_EGL
+	// surfaceless platform: no X11 or Wayland connection, no GPU device needed (llvmpipe)
+	EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+	const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS); // null without EGL_EXT_client_extensions
+	if (hasExtension(clientExtensions, "EGL_EXT_platform_base") && hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+	{
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+			reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+		if (getPlatformDisplay)
+		{
+			eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		}
+	}
+	if (eglDisplay == EGL_NO_DISPLAY)
+	{
+		eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	EGLint eglMajor = 0, eglMinor = 0;
+	if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &eglMajor, &eglMinor))
+	{
+		std::cerr << "No EGL display (error 0x" << std::hex << eglGetError() << std::dec << ")." << std::endl;
+		return false;
+	}
+	display = eglDisplay;
+
+	const char* extensions = eglQueryString(eglDisplay, EGL_EXTENSIONS);
+	if (!hasExtension(extensions, "EGL_KHR_create_context") || !eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cerr << "EGL " << eglMajor << "." << eglMinor << " cannot create desktop OpenGL core contexts." << std::endl;
+		return false;
+	}
+	const bool surfaceless = hasExtension(extensions, "EGL_KHR_surfaceless_context");
+
+	// the framebuffer object has the color and depth buffers, the config only needs OpenGL
+	const EGLint configAttributes[] =
+	{
+		EGL_SURFACE_TYPE,    surfaceless ? 0 : EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint configs = 0;
+	if (!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configs) || configs < 1)
+	{
+		std::cerr << "No EGL config for OpenGL." << std::endl;
+		return false;
+	}
+
+	const EGLint contextAttributes[] =
+	{
+		EGL_CONTEXT_MAJOR_VERSION_KHR,       major,
+		EGL_CONTEXT_MINOR_VERSION_KHR,       minor,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+		EGL_CONTEXT_FLAGS_KHR,               EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE_BIT_KHR | (debug ? EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR : 0),
+		EGL_NONE
+	};
+	EGLContext eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+	if (eglContext == EGL_NO_CONTEXT)
+	{
+		std::cerr << "No OpenGL " << major << "." << minor << " core context (error 0x" << std::hex << eglGetError() << std::dec << ")." << std::endl;
+		return false;
+	}
+	context = eglContext;
+
+	EGLSurface eglSurface = EGL_NO_SURFACE;
+	if (!surfaceless)
+	{
+		const EGLint pbufferAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		eglSurface = eglCreatePbufferSurface(eglDisplay, config, pbufferAttributes);
+		if (eglSurface == EGL_NO_SURFACE)
+		{
+			std::cerr << "No EGL pbuffer (error 0x" << std::hex << eglGetError() << std::dec << ")." << std::endl;
+			return false;
+		}
+		surface = eglSurface;
+	}
+
+	if (!eglMakeCurrent(eglDisplay, eglSurface, eglSurface, eglContext))
+	{
+		std::cerr << "Cannot make the EGL context current (error 0x" << std::hex << eglGetError() << std::dec << ")." << std::endl;
+		return false;
+	}
+	return true;
+#else
+	(void)major; (void)minor; (void)debug;
+	return false;
+#endif
+}
+
+bool HeadlessContext::resize(int width, int height)
+{
+	if (framebuffer == 0)
+	{
+		return false;
+	}
+	this->width = width > 0 ? width : 1;
+	this->height = height > 0 ? height : 1;
+
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, this->width, this->height);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, this->width, this->height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "Framebuffer incomplete (0x" << std::hex << status << std::dec << ")." << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void HeadlessContext::destroy(void)
+{
+#if CG_HEADLESS_EGL
+	if (context && framebuffer)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &colorBuffer);
+		glDeleteRenderbuffers(1, &depthBuffer);
+	}
+	if (display)
+	{
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (surface)
+		{
+			eglDestroySurface(display, surface);
+		}
+		if (context)
+		{
+			eglDestroyContext(display, context);
+		}
+		eglTerminate(display);
+	}
+#endif
+	display = nullptr;
+	context = nullptr;
+	surface = nullptr;
+	framebuffer = colorBuffer = depthBuffer = 0;
+	width = height = 0;
+}
+
+bool HeadlessContext::writePPM(const std::string& filename) const
+{
+	if (framebuffer == 0)
+	{
+		return false;
+	}
+	std::ofstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	std::vector<char> pixels(size_t(width) * height * 3);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+	// GL rows start at the bottom
+	file << "P6\n" << width << " " << height << "\n255\n";
+	for (int y = height - 1; y >= 0; y--)
+	{
+		file.write(&pixels[size_t(y) * width * 3], size_t(width) * 3);
+	}
+	return bool(file);
+}
+
+GLuint HeadlessContext::getFramebuffer(void) const
+{
+	return framebuffer;
+}
+
+int HeadlessContext::getWidth(void) const
+{
+	return width;
+}
+
+int HeadlessContext::getHeight(void) const
+{
+	return height;
+}
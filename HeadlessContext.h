@@ -0,0 +1,67 @@
+#pragma once
+
+#ifndef HEADLESSCONTEXT_H
+#define HEADLESSCONTEXT_H
+
+#include <string>
+
+#include <GL/glew.h>
+
+// 1: built with EGL (CMake option HEADLESS), otherwise create always fails
+#ifndef CG_HEADLESS_EGL
+#define CG_HEADLESS_EGL 0
+#endif
+
+namespace cg
+{
+	/*
+	 OpenGL context without a window or X11 display, for benchmarks on display-less machines
+	 (e.g. Mesa llvmpipe). Uses an EGL surfaceless display (EGL_MESA_platform_surfaceless) if
+	 available, the default EGL display otherwise, and a 1x1 pbuffer where the context cannot be
+	 current without a surface. The rendering goes into a framebuffer object with RGBA8 color
+	 and 24 bit depth, which stays bound and replaces the default framebuffer of a window.
+	 create also initializes GLEW.
+
+	 PROTOCOL
+	 this->create(width, height, major, minor) // instead of glutInit .. glutCreateWindow and glewInit
+	 this->resize                              // size of the framebuffer, the viewport is left unchanged
+	 this->writePPM                            // reads the color buffer back
+	 this->destroy                             // or on destruction, after all other GL objects
+	*/
+	class HeadlessContext
+	{
+	public:
+		HeadlessContext(void);
+		~HeadlessContext(void);
+		HeadlessContext(const HeadlessContext&) = delete;
+		HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+		static bool isAvailable(void); // compiled with EGL
+
+		// core profile, forward compatible; errors are written to std::cerr
+		bool create(int width, int height, int major = 4, int minor = 3, bool debug = false);
+		bool resize(int width, int height);
+		void destroy(void);
+
+		bool writePPM(const std::string& filename) const; // binary P6, top row first
+
+		GLuint getFramebuffer(void) const;
+		int getWidth(void) const;
+		int getHeight(void) const;
+
+	private:
+		bool createContext(int major, int minor, bool debug);
+
+		// EGLDisplay, EGLContext, EGLSurface: no EGL types in the header
+		void* display;
+		void* context;
+		void* surface; // EGL_NO_SURFACE with EGL_KHR_surfaceless_context
+
+		GLuint framebuffer;
+		GLuint colorBuffer;
+		GLuint depthBuffer;
+		int width, height;
+	};
+};
+
+#endif
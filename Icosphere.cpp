@@ -0,0 +1,306 @@
+#include "Icosphere.h"
+
+#include <algorithm>
+#include <thread>
+
+using namespace cg;
+
+namespace
+{
+	const size_t PARALLEL_TRIANGLES = 16384; // smaller parent levels are subdivided serially
+	const uint32_t FOREIGN = 0xFFFFFFFF;     // edge midpoint created by an earlier slice
+
+	uint64_t edgeKey(uint32_t a, uint32_t b)
+	{
+		return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+	}
+
+	// work(slice) for every slice in its own thread, the last one in the calling thread
+	template <typename Work>
+	void parallel(unsigned slices, const Work& work)
+	{
+		std::vector<std::thread> threads;
+		for (unsigned slice = 0; slice + 1 < slices; slice++)
+		{
+			threads.emplace_back(work, slice);
+		}
+		work(slices - 1);
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	// Consecutive parent triangles and their edges, numbered in the order of their first use.
+	struct Slice
+	{
+		size_t first, end;                            // parent triangles [first, end)
+		std::unordered_map<uint64_t, uint32_t> edges; // key -> local edge
+		std::vector<uint64_t> keys;                   // local edge -> key
+		std::vector<uint8_t>  uses;                   // local edge -> triangles of this slice using it
+		std::vector<uint32_t> ids;                    // local edge -> midpoint vertex, FOREIGN if not owned
+		std::vector<uint32_t> triangleEdges;          // 3 local edges per triangle
+		uint32_t firstId;                             // id of the first owned midpoint
+	};
+}
+
+Icosphere::Icosphere(int maxLevel)
+{
+	build(maxLevel);
+}
+
+void Icosphere::build(int maxLevel, unsigned threads)
+{
+	if (maxLevel < 0)
+	{
+		maxLevel = 0;
+	}
+
+	// Level n has 20 * 4^n triangles and 10 * 4^n + 2 vertices.
+	size_t maxTriangles = size_t(20) << (2 * maxLevel);
+	size_t totalIndices = 0;
+	for (int n = 0; n <= maxLevel; n++)
+	{
+		totalIndices += 3 * (size_t(20) << (2 * n));
+	}
+
+	vertices.clear();
+	indices.clear();
+	levels.clear();
+	vertices.reserve(maxTriangles / 2 + 2);
+	indices.reserve(totalIndices);
+	levels.reserve(maxLevel + 1);
+
+	// Level 0: icosahedron.
+	const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+	const glm::vec3 corners[12] = {
+		{ -1.0f,  t, 0.0f }, { 1.0f,  t, 0.0f }, { -1.0f, -t, 0.0f }, { 1.0f, -t, 0.0f },
+		{ 0.0f, -1.0f,  t }, { 0.0f, 1.0f,  t }, { 0.0f, -1.0f, -t }, { 0.0f, 1.0f, -t },
+		{  t, 0.0f, -1.0f }, {  t, 0.0f, 1.0f }, { -t, 0.0f, -1.0f }, { -t, 0.0f, 1.0f }
+	};
+	const uint32_t faces[60] = {
+		0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
+		1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
+		3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
+		4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1
+	};
+
+	for (const glm::vec3& corner : corners)
+	{
+		vertices.push_back(glm::normalize(corner));
+	}
+	indices.assign(faces, faces + 60);
+	levels.push_back({ 0, 60, 12 });
+
+	if (threads == 0)
+	{
+		threads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	// Level n+1: split every triangle of level n into 4.
+	for (int n = 1; n <= maxLevel; n++)
+	{
+		const Level parent = levels.back();
+
+		if (threads > 1 && parent.indexCount / 3 >= PARALLEL_TRIANGLES)
+		{
+			subdivide(parent, threads);
+		}
+		else
+		{
+			subdivide(parent);
+		}
+	}
+}
+
+void Icosphere::subdivide(const Level& parent)
+{
+	edgeMidpoints.clear();
+	edgeMidpoints.reserve(parent.indexCount / 2); // every edge is shared by 2 triangles
+
+	Level current;
+	current.firstIndex = indices.size();
+
+	for (size_t i = parent.firstIndex; i < parent.firstIndex + parent.indexCount; i += 3)
+	{
+		// indices may grow, read the parent triangle first
+		uint32_t v0 = indices[i];
+		uint32_t v1 = indices[i + 1];
+		uint32_t v2 = indices[i + 2];
+
+		uint32_t a = midpoint(v0, v1);
+		uint32_t b = midpoint(v1, v2);
+		uint32_t c = midpoint(v2, v0);
+
+		const uint32_t triangles[12] = { v0, a, c,   v1, b, a,   v2, c, b,   a, b, c };
+		indices.insert(indices.end(), triangles, triangles + 12);
+	}
+
+	current.indexCount  = indices.size() - current.firstIndex;
+	current.vertexCount = vertices.size();
+	levels.push_back(current);
+
+	edgeMidpoints.clear();
+}
+
+void Icosphere::subdivide(const Level& parent, unsigned threads)
+{
+	const size_t triangles = parent.indexCount / 3;
+	const uint32_t* parentIndices = &indices[parent.firstIndex];
+
+	std::vector<Slice> slices(threads);
+	for (unsigned s = 0; s < threads; s++)
+	{
+		slices[s].first = triangles * s / threads;
+		slices[s].end   = triangles * (s + 1) / threads;
+	}
+
+	// 1. every slice numbers its edges in the order of their first use
+	parallel(threads, [&](unsigned s)
+	{
+		Slice& slice = slices[s];
+		size_t count = slice.end - slice.first;
+		slice.edges.reserve(count * 3 / 2 + 16);
+		slice.triangleEdges.resize(count * 3);
+
+		for (size_t t = slice.first; t < slice.end; t++)
+		{
+			const uint32_t* v = parentIndices + 3 * t;
+			for (int e = 0; e < 3; e++)
+			{
+				uint64_t key = edgeKey(v[e], v[(e + 1) % 3]);
+				auto inserted = slice.edges.emplace(key, uint32_t(slice.keys.size()));
+				if (inserted.second)
+				{
+					slice.keys.push_back(key);
+					slice.uses.push_back(0);
+				}
+				slice.uses[inserted.first->second]++;
+				slice.triangleEdges[3 * (t - slice.first) + e] = inserted.first->second;
+			}
+		}
+		slice.ids.assign(slice.keys.size(), 0);
+	});
+
+	// 2. edges used once in a slice may continue in another one: the first slice owns them
+	std::unordered_map<uint64_t, std::pair<unsigned, uint32_t>> owners; // key -> slice, local edge
+	uint32_t next = uint32_t(vertices.size());
+	for (unsigned s = 0; s < threads; s++)
+	{
+		Slice& slice = slices[s];
+		uint32_t owned = uint32_t(slice.keys.size());
+		for (uint32_t e = 0; e < slice.keys.size(); e++)
+		{
+			if (slice.uses[e] == 1 && !owners.emplace(slice.keys[e], std::make_pair(s, e)).second)
+			{
+				slice.ids[e] = FOREIGN;
+				owned--;
+			}
+		}
+		slice.firstId = next;
+		next += owned;
+	}
+
+	// 3. owned midpoints in the order of their first use, slice after slice
+	vertices.resize(next);
+	parallel(threads, [&](unsigned s)
+	{
+		Slice& slice = slices[s];
+		uint32_t id = slice.firstId;
+		for (uint32_t e = 0; e < slice.keys.size(); e++)
+		{
+			if (slice.ids[e] != FOREIGN)
+			{
+				uint32_t a = uint32_t(slice.keys[e] >> 32);
+				uint32_t b = uint32_t(slice.keys[e]);
+				vertices[id] = glm::normalize(vertices[a] + vertices[b]);
+				slice.ids[e] = id++;
+			}
+		}
+	});
+
+	// 4. foreign midpoints from their owners, then the triangles
+	Level current;
+	current.firstIndex  = indices.size();
+	current.indexCount  = 4 * parent.indexCount;
+	current.vertexCount = vertices.size();
+	indices.resize(current.firstIndex + current.indexCount); // reserved by build, parentIndices stays valid
+
+	parallel(threads, [&](unsigned s)
+	{
+		Slice& slice = slices[s];
+		for (uint32_t e = 0; e < slice.keys.size(); e++)
+		{
+			if (slice.ids[e] == FOREIGN)
+			{
+				const std::pair<unsigned, uint32_t>& owner = owners.at(slice.keys[e]);
+				slice.ids[e] = slices[owner.first].ids[owner.second];
+			}
+		}
+
+		uint32_t* out = &indices[current.firstIndex + 12 * slice.first];
+		for (size_t t = slice.first; t < slice.end; t++)
+		{
+			const uint32_t* v = parentIndices + 3 * t;
+			const uint32_t* e = &slice.triangleEdges[3 * (t - slice.first)];
+			uint32_t a = slice.ids[e[0]];
+			uint32_t b = slice.ids[e[1]];
+			uint32_t c = slice.ids[e[2]];
+
+			const uint32_t triangles[12] = { v[0], a, c,   v[1], b, a,   v[2], c, b,   a, b, c };
+			std::copy(triangles, triangles + 12, out);
+			out += 12;
+		}
+	});
+
+	levels.push_back(current);
+}
+
+uint32_t Icosphere::midpoint(uint32_t a, uint32_t b)
+{
+	uint64_t key = a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+
+	auto it = edgeMidpoints.find(key);
+	if (it != edgeMidpoints.end())
+	{
+		return it->second;
+	}
+
+	uint32_t id = uint32_t(vertices.size());
+	vertices.push_back(glm::normalize(vertices[a] + vertices[b]));
+	edgeMidpoints.emplace(key, id);
+
+	return id;
+}
+
+int Icosphere::maxLevel(void) const
+{
+	return int(levels.size()) - 1;
+}
+
+const Icosphere::Level& Icosphere::level(int n) const
+{
+	return levels[glm::clamp(n, 0, maxLevel())];
+}
+
+const std::vector<glm::vec3>& Icosphere::getVertices(void) const
+{
+	return vertices;
+}
+
+const std::vector<uint32_t>& Icosphere::getIndices(void) const
+{
+	return indices;
+}
+
+const Icosphere& Icosphere::shared(int maxLevel)
+{
+	static Icosphere cache;
+
+	if (cache.maxLevel() < maxLevel)
+	{
+		cache.build(maxLevel);
+	}
+
+	return cache;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#ifndef ICOSPHERE_H
+#define ICOSPHERE_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+namespace cg
+{
+	/*
+	 Unit icosphere with all subdivision levels 0..maxLevel precomputed.
+	 Subdividing a level only appends the edge midpoints, so the vertices of level n
+	 are a prefix of the vertices of level n+1. All levels share one vertex array and
+	 store their triangles back to back in one index array:
+	 selecting a level is only a change of the draw range (Level::firstIndex, Level::indexCount).
+	 Large levels are subdivided by several threads, each taking a slice of the parent triangles
+	 with its own edge-midpoint map. Edges shared between slices belong to the first slice using
+	 them, so the result is identical to the serial subdivision for any number of threads.
+
+	 USAGE
+	 const Icosphere& ico = Icosphere::shared(4); // built once, shared by all spheres
+	 upload ico.getVertices() and ico.getIndices() once
+	 glDrawRangeElements(.., 0, level.vertexCount - 1, level.indexCount, .., level.firstIndex)
+	*/
+	class Icosphere
+	{
+	public:
+		struct Level
+		{
+			size_t firstIndex;  // offset of the first index of this level (in indices, not bytes)
+			size_t indexCount;  // 3 * number of triangles
+			size_t vertexCount; // vertices [0, vertexCount) are used by this level
+		};
+
+		Icosphere(int maxLevel = 0);
+
+		void build(int maxLevel, unsigned threads = 0); // (re)computes levels 0..maxLevel, 0 threads: all hardware threads
+
+		int maxLevel(void) const;
+		const Level& level(int n) const;
+
+		const std::vector<glm::vec3>& getVertices(void) const; // unit length, i.e. also the normals
+		const std::vector<uint32_t>&  getIndices (void) const;
+
+		static const Icosphere& shared(int maxLevel); // process wide cache, grows on demand
+
+	private:
+		uint32_t midpoint(uint32_t a, uint32_t b); // deduplicated via edgeMidpoints
+		void subdivide(const Level& parent);                    // serial, via midpoint
+		void subdivide(const Level& parent, unsigned threads);  // same result
+
+		std::vector<glm::vec3> vertices;
+		std::vector<uint32_t>  indices;
+		std::vector<Level>     levels;
+
+		std::unordered_map<uint64_t, uint32_t> edgeMidpoints; // (min, max) vertex id -> midpoint id
+	};
+};
+
+#endif
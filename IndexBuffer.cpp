@@ -0,0 +1,203 @@
+#include "IndexBuffer.h"
+
+#include <algorithm>
+
+#include "GLState.h"
+
+using namespace cg;
+
+IndexBuffer::IndexBuffer(size_t maxChunks)
+: handle(0)
+, maxChunks(maxChunks)
+{
+}
+
+IndexBuffer::~IndexBuffer(void)
+{
+	GLState::deleteBuffers(1, &handle);
+	handle = 0;
+}
+
+GLenum IndexBuffer::selectType(uint32_t maxIndex)
+{
+	if (maxIndex <= 0xFF)
+	{
+		return GL_UNSIGNED_BYTE;
+	}
+	if (maxIndex <= 0xFFFF)
+	{
+		return GL_UNSIGNED_SHORT;
+	}
+	return GL_UNSIGNED_INT;
+}
+
+size_t IndexBuffer::typeSize(GLenum type)
+{
+	switch (type)
+	{
+	case GL_UNSIGNED_BYTE:  return sizeof(GLubyte);
+	case GL_UNSIGNED_SHORT: return sizeof(GLushort);
+	default:                return sizeof(GLuint);
+	}
+}
+
+size_t IndexBuffer::add(const std::vector<uint32_t>& indices, size_t primitiveSize)
+{
+	return add(indices.data(), indices.size(), primitiveSize);
+}
+
+size_t IndexBuffer::add(const uint32_t* indices, size_t count, size_t primitiveSize)
+{
+	std::vector<Chunk> mesh;
+
+	if (count > 0)
+	{
+		auto range = std::minmax_element(indices, indices + count);
+		uint32_t first = *range.first;
+		uint32_t span  = *range.second - first;
+
+		if (span <= 0xFFFF)
+		{
+			append(indices, count, selectType(span), first, mesh);
+		}
+		else
+		{
+			// Split into runs of whole primitives whose vertex span fits into 16 bit.
+			std::vector<std::pair<size_t, size_t>> runs; // [begin, end) into indices
+			size_t begin = 0;
+			uint32_t lo = UINT32_MAX, hi = 0;
+
+			for (size_t i = 0; i + primitiveSize <= count && runs.size() <= maxChunks; i += primitiveSize)
+			{
+				uint32_t plo = *std::min_element(indices + i, indices + i + primitiveSize);
+				uint32_t phi = *std::max_element(indices + i, indices + i + primitiveSize);
+
+				// a primitive that alone spans more than 16 bit gets a run of its own, never an empty one
+				if (i > begin && std::max(hi, phi) - std::min(lo, plo) > 0xFFFF)
+				{
+					runs.push_back({ begin, i });
+					begin = i;
+					lo = UINT32_MAX;
+					hi = 0;
+				}
+				lo = std::min(lo, plo);
+				hi = std::max(hi, phi);
+			}
+			runs.push_back({ begin, count });
+
+			if (runs.size() <= maxChunks)
+			{
+				for (const auto& run : runs)
+				{
+					auto r = std::minmax_element(indices + run.first, indices + run.second);
+					append(indices + run.first, run.second - run.first, selectType(*r.second - *r.first), *r.first, mesh);
+				}
+			}
+			else
+			{
+				append(indices, count, GL_UNSIGNED_INT, first, mesh);
+			}
+		}
+	}
+
+	meshes.push_back(mesh);
+	return meshes.size() - 1;
+}
+
+void IndexBuffer::append(const uint32_t* indices, size_t count, GLenum type, uint32_t base, std::vector<Chunk>& out)
+{
+	size_t size = typeSize(type);
+
+	// offsets must be aligned to the index size
+	data.resize((data.size() + size - 1) / size * size);
+
+	Chunk chunk;
+	chunk.type       = type;
+	chunk.count      = GLsizei(count);
+	chunk.offset     = data.size();
+	chunk.baseVertex = GLint(base);
+	chunk.start      = UINT32_MAX;
+	chunk.end        = 0;
+
+	data.resize(data.size() + count * size);
+	uint8_t* dst = data.data() + chunk.offset;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t index = indices[i] - base;
+		chunk.start = std::min(chunk.start, index);
+		chunk.end   = std::max(chunk.end, index);
+
+		switch (type)
+		{
+		case GL_UNSIGNED_BYTE:
+			dst[i] = GLubyte(index);
+			break;
+		case GL_UNSIGNED_SHORT:
+			reinterpret_cast<GLushort*>(dst)[i] = GLushort(index);
+			break;
+		default:
+			reinterpret_cast<GLuint*>(dst)[i] = index;
+			break;
+		}
+	}
+
+	out.push_back(chunk);
+}
+
+void IndexBuffer::upload(void)
+{
+	if (handle < 1)
+	{
+		glGenBuffers(1, &handle);
+	}
+
+	GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, handle);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.size(), data.data(), GL_STATIC_DRAW);
+}
+
+void IndexBuffer::draw(size_t mesh, GLenum mode) const
+{
+	for (const Chunk& chunk : meshes[mesh])
+	{
+		glDrawRangeElementsBaseVertex(mode, chunk.start, chunk.end, chunk.count, chunk.type,
+			reinterpret_cast<void*>(chunk.offset), chunk.baseVertex);
+	}
+}
+
+void IndexBuffer::drawInstanced(size_t mesh, GLsizei instances, GLenum mode, GLuint baseInstance) const
+{
+	for (const Chunk& chunk : meshes[mesh])
+	{
+		if (baseInstance == 0)
+		{
+			glDrawElementsInstancedBaseVertex(mode, chunk.count, chunk.type,
+				reinterpret_cast<void*>(chunk.offset), instances, chunk.baseVertex);
+		}
+		else
+		{
+			glDrawElementsInstancedBaseVertexBaseInstance(mode, chunk.count, chunk.type,
+				reinterpret_cast<void*>(chunk.offset), instances, chunk.baseVertex, baseInstance);
+		}
+	}
+}
+
+const std::vector<IndexBuffer::Chunk>& IndexBuffer::chunks(size_t mesh) const
+{
+	return meshes[mesh];
+}
+
+size_t IndexBuffer::meshCount(void) const
+{
+	return meshes.size();
+}
+
+size_t IndexBuffer::sizeInBytes(void) const
+{
+	return data.size();
+}
+
+GLuint IndexBuffer::getHandle(void) const
+{
+	return handle;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#ifndef INDEXBUFFER_H
+#define INDEXBUFFER_H
+
+#include <vector>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+namespace cg
+{
+	/*
+	 Index buffer holding one or more meshes, each stored with the smallest index type
+	 that fits the vertices it references:
+	  GL_UNSIGNED_BYTE  up to 256 vertices
+	  GL_UNSIGNED_SHORT up to 65536 vertices
+	  GL_UNSIGNED_INT   otherwise, unless the mesh can be split into a few GL_UNSIGNED_SHORT
+	                    chunks (consecutive triangles spanning < 65536 vertices) that are drawn
+	                    with a base vertex; this halves the index bandwidth.
+
+	 PROTOCOL
+	 this->add         // for every mesh, returns the mesh id
+	 this->upload      // with the VAO bound (GL_ELEMENT_ARRAY_BUFFER is VAO state)
+	 this->draw        // with the VAO bound
+	 this->drawInstanced // same, instance attributes need a divisor (VertexFormat::setup),
+	                     // baseInstance offsets them (GL 4.2)
+	*/
+	class IndexBuffer
+	{
+	public:
+		struct Chunk
+		{
+			GLenum  type;       // GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+			GLsizei count;      // number of indices
+			size_t  offset;     // byte offset into the buffer
+			GLint   baseVertex; // added to every index of the chunk
+			GLuint  start, end; // referenced vertex range (before baseVertex)
+		};
+
+		IndexBuffer(size_t maxChunks = 8); // max. u16 chunks before a mesh falls back to u32
+		~IndexBuffer(void);                // GL context must exist on destruction
+
+		size_t add(const uint32_t* indices, size_t count, size_t primitiveSize = 3);
+		size_t add(const std::vector<uint32_t>& indices, size_t primitiveSize = 3);
+		void upload(void);
+		void draw(size_t mesh, GLenum mode = GL_TRIANGLES) const;
+		void drawInstanced(size_t mesh, GLsizei instances, GLenum mode = GL_TRIANGLES, GLuint baseInstance = 0) const;
+
+		const std::vector<Chunk>& chunks(size_t mesh) const;
+		size_t meshCount(void) const;
+		size_t sizeInBytes(void) const;
+		GLuint getHandle(void) const;
+
+		static GLenum selectType(uint32_t maxIndex); // smallest type for indices [0, maxIndex]
+		static size_t typeSize(GLenum type);
+
+	private:
+		IndexBuffer(const IndexBuffer&) = delete;
+		IndexBuffer& operator=(const IndexBuffer&) = delete;
+
+		void append(const uint32_t* indices, size_t count, GLenum type, uint32_t base, std::vector<Chunk>& out);
+
+		GLuint handle;
+		size_t maxChunks;
+		std::vector<uint8_t> data;               // encoded indices of all meshes
+		std::vector<std::vector<Chunk>> meshes;  // draw calls per mesh
+	};
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include "LatticeSphere.h"
+
+#include "Icosphere.h"
+
+using namespace cg;
+
+namespace
+{
+	// The 30 icosahedron edges (a < b) in the order of their first use by the faces, and the
+	// edge of every corner pair.
+	struct Edges
+	{
+		uint32_t a[30], b[30];
+		int8_t   index[12][12];
+
+		Edges(const uint32_t* faces)
+		{
+			int count = 0;
+			for (int i = 0; i < 12; i++)
+			{
+				for (int j = 0; j < 12; j++)
+				{
+					index[i][j] = -1;
+				}
+			}
+			for (int f = 0; f < 20; f++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t u = faces[3 * f + k];
+					uint32_t v = faces[3 * f + (k + 1) % 3];
+					if (index[u][v] < 0)
+					{
+						a[count] = glm::min(u, v);
+						b[count] = glm::max(u, v);
+						index[u][v] = index[v][u] = int8_t(count++);
+					}
+				}
+			}
+		}
+	};
+}
+
+size_t LatticeSphere::vertexCount(int frequency)
+{
+	return 10 * size_t(frequency) * frequency + 2;
+}
+
+size_t LatticeSphere::indexCount(int frequency)
+{
+	return 60 * size_t(frequency) * frequency;
+}
+
+void LatticeSphere::generate(int frequency, glm::vec3* vertices, uint32_t* indices, uint32_t baseVertex)
+{
+	static const Icosphere icosahedron(0);
+	const glm::vec3* corners = icosahedron.getVertices().data();
+	const uint32_t*  faces   = icosahedron.getIndices().data();
+	static const Edges edges(faces);
+
+	const int n = frequency;
+	const uint32_t edgeBase = 12;                             // n - 1 points per edge, from a to b
+	const uint32_t faceBase = edgeBase + 30 * uint32_t(n - 1); // (n - 1)(n - 2) / 2 points per face
+	const uint32_t facePoints = uint32_t((n - 1) * (n - 2) / 2);
+	const float step = 1.0f / float(n);
+
+	// corners and edges once, so shared points are bitwise identical for all faces
+	for (int c = 0; c < 12; c++)
+	{
+		vertices[c] = corners[c];
+	}
+	for (int e = 0; e < 30; e++)
+	{
+		for (int k = 1; k < n; k++)
+		{
+			float t = float(k) * step;
+			vertices[edgeBase + e * (n - 1) + k - 1] = glm::normalize(corners[edges.a[e]] * (1.0f - t) + corners[edges.b[e]] * t);
+		}
+	}
+
+	for (int f = 0; f < 20; f++)
+	{
+		const uint32_t c0 = faces[3 * f], c1 = faces[3 * f + 1], c2 = faces[3 * f + 2];
+		const int e01 = edges.index[c0][c1], e02 = edges.index[c0][c2], e12 = edges.index[c1][c2];
+		const uint32_t interior = faceBase + f * facePoints;
+
+		// point k of n on the edge from u to v
+		auto edgePoint = [&](int e, uint32_t u, int k) -> uint32_t
+		{
+			return edgeBase + e * (n - 1) + (u == edges.a[e] ? k : n - k) - 1;
+		};
+
+		// id of the lattice point c0 + i (c1 - c0) / n + j (c2 - c0) / n
+		auto id = [&](int i, int j) -> uint32_t
+		{
+			if (i + j == n)
+			{
+				return i == n ? c1 : (j == n ? c2 : edgePoint(e12, c1, j));
+			}
+			if (j == 0)
+			{
+				return i == 0 ? c0 : edgePoint(e01, c0, i);
+			}
+			if (i == 0)
+			{
+				return edgePoint(e02, c0, j);
+			}
+			// rows j = 1 .. n - 2 with n - 1 - j points each
+			return interior + uint32_t((j - 1) * (n - 1) - (j - 1) * j / 2 + i - 1);
+		};
+
+		for (int j = 1; j < n - 1; j++)
+		{
+			for (int i = 1; i + j < n; i++)
+			{
+				float u = float(i) * step, v = float(j) * step;
+				vertices[id(i, j)] = glm::normalize(corners[c0] * (1.0f - u - v) + corners[c1] * u + corners[c2] * v);
+			}
+		}
+
+		// n^2 triangles, winding of the face: per row the upward ones and the downward ones between them
+		uint32_t* out = indices + size_t(f) * 3 * n * n;
+		for (int j = 0; j < n; j++)
+		{
+			for (int i = 0; i + j < n; i++)
+			{
+				*out++ = baseVertex + id(i, j);
+				*out++ = baseVertex + id(i + 1, j);
+				*out++ = baseVertex + id(i, j + 1);
+
+				if (i + j + 1 < n)
+				{
+					*out++ = baseVertex + id(i + 1, j);
+					*out++ = baseVertex + id(i + 1, j + 1);
+					*out++ = baseVertex + id(i, j + 1);
+				}
+			}
+		}
+	}
+}
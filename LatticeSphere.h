@@ -0,0 +1,36 @@
+#pragma once
+
+#ifndef LATTICESPHERE_H
+#define LATTICESPHERE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+namespace cg
+{
+	/*
+	 Indexed unit sphere of a given frequency n without any edge map: every icosahedron face is
+	 covered by the barycentric lattice (i, j), i + j <= n, and every lattice point has a closed-form
+	 vertex id (corners first, then n - 1 points per icosahedron edge, then the face interiors).
+	 Vertex and index counts are known in advance, both arrays are written in one pass.
+	 Frequency 2^level has the counts of Icosphere::level(level); the points are the projected
+	 lattice points, not the repeated midpoints, so the positions differ slightly.
+
+	 USAGE
+	 positions(vertexCount(n)), indices(indexCount(n))
+	 LatticeSphere::generate(n, positions.data(), indices.data())
+	*/
+	class LatticeSphere
+	{
+	public:
+		static size_t vertexCount(int frequency); // 10 n^2 + 2
+		static size_t indexCount(int frequency);  // 3 * 20 n^2
+
+		// baseVertex is added to every index, e.g. for several spheres in one vertex array
+		static void generate(int frequency, glm::vec3* vertices, uint32_t* indices, uint32_t baseVertex = 0);
+	};
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include "LevelOfDetail.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace cg;
+
+namespace
+{
+	const float EDGE = 1.0515f; // icosahedron edge length / circumradius
+}
+
+const uint8_t LevelOfDetail::NONE;
+
+LevelOfDetail::LevelOfDetail(void)
+: pixelsPerEdge(8.0f), hysteresis(0.25f), budget(0)
+{
+}
+
+void LevelOfDetail::setLevels(const std::vector<size_t>& trianglesPerLevel)
+{
+	triangles = trianglesPerLevel;
+	reset();
+}
+
+void LevelOfDetail::setPixelsPerEdge(float pixels)
+{
+	pixelsPerEdge = pixels;
+}
+
+void LevelOfDetail::setHysteresis(float levels)
+{
+	hysteresis = levels;
+}
+
+void LevelOfDetail::setTriangleBudget(size_t triangles)
+{
+	budget = triangles;
+}
+
+void LevelOfDetail::reset(void)
+{
+	levels.clear();
+}
+
+int LevelOfDetail::level(uint32_t id) const
+{
+	return id < levels.size() && levels[id] != NONE ? levels[id] : 0;
+}
+
+int LevelOfDetail::levelCount(void) const
+{
+	return int(triangles.size());
+}
+
+float LevelOfDetail::screenRadius(const glm::vec3& center, float radius, const glm::mat4& projection, float viewportHeight)
+{
+	float scale = projection[1][1] * 0.5f * viewportHeight; // pixels per unit at distance 1
+
+	if (projection[3][3] == 1.0f)
+	{
+		return radius * scale; // orthographic
+	}
+
+	// tangent of the half angle of the cone around the sphere
+	float d2 = glm::dot(center, center);
+	float r2 = radius * radius;
+	if (d2 <= r2)
+	{
+		return 1.0e30f; // camera inside
+	}
+	return radius / std::sqrt(d2 - r2) * scale;
+}
+
+void LevelOfDetail::select(const glm::mat4& modelView, const glm::mat4& projection, float viewportHeight,
+	const std::vector<glm::vec4>& spheres, const std::vector<uint32_t>& ids, Selection& selection)
+{
+	const int count = levelCount();
+	const int maxLevel = count - 1;
+
+	// model space radii scale with the model-view matrix
+	float scale = glm::length(glm::vec3(modelView[0]));
+
+	std::vector<uint8_t> chosen(ids.size());
+	std::vector<uint32_t> histogram(count, 0);
+
+	for (size_t i = 0; i < ids.size(); i++)
+	{
+		uint32_t id = ids[i];
+		if (id >= levels.size())
+		{
+			levels.resize(id + 1, NONE);
+		}
+
+		const glm::vec4& sphere = spheres[id];
+		glm::vec3 center = glm::vec3(modelView * glm::vec4(glm::vec3(sphere), 1.0f));
+		float pixels = screenRadius(center, sphere.w * scale, projection, viewportHeight);
+
+		// continuous level: edges of exactly pixelsPerEdge pixels
+		float wanted = std::log2(std::max(EDGE * pixels / pixelsPerEdge, 1.0e-6f));
+		int level = glm::clamp(int(std::ceil(wanted)), 0, maxLevel);
+
+		// level p covers (p - 1, p], keep it within the hysteresis
+		int previous = levels[id];
+		if (previous != NONE && wanted > previous - 1 - hysteresis && wanted <= previous + hysteresis)
+		{
+			level = previous;
+		}
+
+		levels[id] = uint8_t(level);
+		chosen[i] = uint8_t(level);
+		histogram[level]++;
+	}
+
+	// smallest bias that fits into the budget
+	selection.bias = 0;
+	for (;;)
+	{
+		selection.triangles = 0;
+		for (int level = 0; level < count; level++)
+		{
+			selection.triangles += histogram[level] * triangles[std::max(level - selection.bias, 0)];
+		}
+		if (budget == 0 || selection.triangles <= budget || selection.bias >= maxLevel)
+		{
+			break;
+		}
+		selection.bias++;
+	}
+
+	// counting sort by biased level
+	selection.first.assign(count + 1, 0);
+	for (int level = 0; level < count; level++)
+	{
+		selection.first[std::max(level - selection.bias, 0) + 1] += histogram[level];
+	}
+	for (int level = 0; level < count; level++)
+	{
+		selection.first[level + 1] += selection.first[level];
+	}
+
+	std::vector<uint32_t> next(selection.first.begin(), selection.first.end() - 1);
+	selection.ids.resize(ids.size());
+	for (size_t i = 0; i < ids.size(); i++)
+	{
+		selection.ids[next[std::max(int(chosen[i]) - selection.bias, 0)]++] = ids[i];
+	}
+}
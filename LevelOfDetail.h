@@ -0,0 +1,67 @@
+#pragma once
+
+#ifndef LEVELOFDETAIL_H
+#define LEVELOFDETAIL_H
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+namespace cg
+{
+	/*
+	 Per object level selection for icospheres from the projected size. Level n has edges of about
+	 1.05 * radius / 2^n, the chosen level is the lowest one whose edges are at most
+	 pixelsPerEdge pixels long on screen.
+	 Hysteresis: an object keeps its level until the wanted (continuous) level leaves the level
+	 by more than the hysteresis, so objects near a threshold do not pop back and forth.
+	 Triangle budget: if the selection has more triangles, all levels are lowered by the same
+	 bias until it fits (the remembered levels are not biased).
+	 PROTOCOL
+	 this->setLevels            // triangles of every level
+	 this->set...               // optional
+	 this->select               // every time the camera, viewport or objects change
+	*/
+	class LevelOfDetail
+	{
+	public:
+		struct Selection
+		{
+			std::vector<uint32_t> ids;   // selected ids ordered by level
+			std::vector<uint32_t> first; // level n: ids[first[n]] .. ids[first[n + 1] - 1]
+			size_t triangles;            // of all selected objects
+			int    bias;                 // levels dropped for the triangle budget
+		};
+
+		LevelOfDetail(void);
+
+		void setLevels(const std::vector<size_t>& trianglesPerLevel);
+		void setPixelsPerEdge(float pixels);     // default 8
+		void setHysteresis(float levels);        // default 0.25
+		void setTriangleBudget(size_t triangles); // 0: unlimited (default)
+
+		// spheres (xyz: center, w: radius) in model space, ids: which of them to select for (e.g. the visible)
+		void select(const glm::mat4& modelView, const glm::mat4& projection, float viewportHeight,
+			const std::vector<glm::vec4>& spheres, const std::vector<uint32_t>& ids, Selection& selection);
+
+		void reset(void); // forget the remembered levels
+		int  level(uint32_t id) const; // last selected level before the bias, 0 if never selected
+
+		int levelCount(void) const;
+
+		// projected radius in pixels of a sphere at center (view space)
+		static float screenRadius(const glm::vec3& center, float radius, const glm::mat4& projection, float viewportHeight);
+
+	private:
+		std::vector<size_t>  triangles; // per level
+		std::vector<uint8_t> levels;    // last level per id, NONE if not selected yet
+		float pixelsPerEdge;
+		float hysteresis;
+		size_t budget;
+
+		static const uint8_t NONE = 0xFF;
+	};
+};
+
+#endif
@@ -0,0 +1,199 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+
+using namespace cg;
+
+const unsigned MeshOptimizer::CACHE_SIZE;
+
+namespace
+{
+	const uint32_t NONE = 0xFFFFFFFF;
+
+	// most recently used candidate with triangles left that stays in the cache while its fan is emitted
+	uint32_t nextVertex(const std::vector<uint32_t>& candidates, const std::vector<uint32_t>& live,
+		const std::vector<uint32_t>& timeStamps, uint32_t time, unsigned cacheSize)
+	{
+		uint32_t best = NONE;
+		int bestPriority = -1;
+		for (uint32_t v : candidates)
+		{
+			if (live[v] == 0)
+			{
+				continue;
+			}
+			int priority = 0;
+			if (time - timeStamps[v] + 2 * live[v] <= cacheSize)
+			{
+				priority = int(time - timeStamps[v]); // age in the cache
+			}
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				best = v;
+			}
+		}
+		return best;
+	}
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, unsigned cacheSize)
+{
+	optimizeVertexCache(indices.data(), indices.size(), vertexCount, cacheSize);
+}
+
+void MeshOptimizer::optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned cacheSize)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// triangles of every vertex: counting sort by vertex
+	std::vector<uint32_t> live(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		live[indices[i]]++;
+	}
+	std::vector<uint32_t> first(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		first[v + 1] = first[v] + live[v];
+	}
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacency[fill[indices[i]]++] = uint32_t(i / 3);
+	}
+
+	std::vector<uint32_t> timeStamps(vertexCount, 0);
+	std::vector<bool>     emitted(triangleCount, false);
+	std::vector<uint32_t> deadEnds;   // recently used vertices, a stack
+	std::vector<uint32_t> candidates; // vertices of the last fan
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+
+	uint32_t time = cacheSize + 1;
+	uint32_t cursor = 0; // next vertex for the linear search when the dead-end stack is empty
+	uint32_t fan = 0;
+
+	while (fan != NONE)
+	{
+		// emit all remaining triangles around fan
+		candidates.clear();
+		for (uint32_t a = first[fan]; a < first[fan + 1]; a++)
+		{
+			uint32_t t = adjacency[a];
+			if (emitted[t])
+			{
+				continue;
+			}
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t v = indices[3 * t + k];
+				output.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (time - timeStamps[v] > cacheSize)
+				{
+					timeStamps[v] = time++; // cache miss
+				}
+			}
+			emitted[t] = true;
+		}
+
+		fan = nextVertex(candidates, live, timeStamps, time, cacheSize);
+
+		// dead end: most recent vertex with triangles left, then any in input order
+		while (fan == NONE && !deadEnds.empty())
+		{
+			uint32_t v = deadEnds.back();
+			deadEnds.pop_back();
+			if (live[v] > 0)
+			{
+				fan = v;
+			}
+		}
+		while (fan == NONE && cursor < vertexCount)
+		{
+			if (live[cursor] > 0)
+			{
+				fan = cursor;
+			}
+			cursor++;
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+size_t MeshOptimizer::optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>& remap)
+{
+	return optimizeVertexFetch(indices.data(), indices.size(), vertexCount, remap);
+}
+
+size_t MeshOptimizer::optimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& remap)
+{
+	remap.assign(vertexCount, NONE);
+
+	uint32_t next = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		uint32_t& index = indices[i];
+		if (remap[index] == NONE)
+		{
+			remap[index] = next++;
+		}
+		index = remap[index];
+	}
+
+	size_t referenced = next;
+	for (uint32_t& target : remap)
+	{
+		if (target == NONE)
+		{
+			target = next++;
+		}
+	}
+	return referenced;
+}
+
+size_t MeshOptimizer::cacheMisses(const uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned cacheSize)
+{
+	// FIFO: a vertex is cached if it was inserted less than cacheSize misses ago
+	std::vector<size_t> inserted(vertexCount, 0);
+	size_t misses = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		size_t& stamp = inserted[indices[i]];
+		if (stamp == 0 || misses - stamp >= cacheSize)
+		{
+			misses++;
+			stamp = misses;
+		}
+	}
+	return misses;
+}
+
+float MeshOptimizer::acmr(const uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned cacheSize)
+{
+	return indexCount < 3 ? 0.0f : float(cacheMisses(indices, indexCount, vertexCount, cacheSize)) / float(indexCount / 3);
+}
+
+float MeshOptimizer::atvr(const uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned cacheSize)
+{
+	std::vector<bool> used(vertexCount, false);
+	size_t referenced = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		if (!used[indices[i]])
+		{
+			used[indices[i]] = true;
+			referenced++;
+		}
+	}
+	return referenced == 0 ? 0.0f : float(cacheMisses(indices, indexCount, vertexCount, cacheSize)) / float(referenced);
+}
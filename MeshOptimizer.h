@@ -0,0 +1,58 @@
+#pragma once
+
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace cg
+{
+	/*
+	 Reordering of indexed triangle lists for the GPU, all passes run in linear time.
+	 optimizeVertexCache: triangle order for the post-transform vertex cache (Tipsify,
+	                      Sander et al. 2007): fans around recently used vertices, jumps to the
+	                      most recent vertex with triangles left at dead ends.
+	 optimizeVertexFetch: vertices in the order of their first use, so the vertex fetch reads
+	                      the buffer almost sequentially. Unreferenced vertices move to the end.
+	 acmr, atvr:          transformed vertices per triangle / per vertex of a FIFO cache, 0.5 and
+	                      1.0 are the ideal values for large closed meshes.
+
+	 USAGE
+	 MeshOptimizer::optimizeVertexCache(indices, count, vertexCount)
+	 MeshOptimizer::optimizeVertexFetch(indices, count, vertexCount, remap)
+	 MeshOptimizer::remapVertices(positions, remap) // for every vertex attribute array
+	*/
+	class MeshOptimizer
+	{
+	public:
+		static const unsigned CACHE_SIZE = 16; // post-transform cache entries assumed by default
+
+		static void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned cacheSize = CACHE_SIZE);
+		static void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, unsigned cacheSize = CACHE_SIZE);
+
+		// remap[old] = new vertex, indices are rewritten, returns the number of referenced vertices
+		static size_t optimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& remap);
+		static size_t optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>& remap);
+
+		template <typename T>
+		static void remapVertices(std::vector<T>& vertices, const std::vector<uint32_t>& remap)
+		{
+			std::vector<T> remapped(vertices.size());
+			for (size_t i = 0; i < vertices.size(); i++)
+			{
+				remapped[remap[i]] = vertices[i];
+			}
+			vertices.swap(remapped);
+		}
+
+		static float acmr(const uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned cacheSize = CACHE_SIZE);
+		static float atvr(const uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned cacheSize = CACHE_SIZE);
+
+	private:
+		static size_t cacheMisses(const uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned cacheSize);
+	};
+};
+
+#endif
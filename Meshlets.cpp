@@ -0,0 +1,344 @@
+#include "Meshlets.h"
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#include <glm/simd/common.h>
+
+using namespace cg;
+
+const unsigned Meshlets::MAX_VERTICES;
+const unsigned Meshlets::MAX_TRIANGLES;
+
+namespace
+{
+	const uint32_t NONE = 0xFFFFFFFF;
+
+	glm::vec3 centroid(const uint32_t* triangle, const glm::vec3* positions)
+	{
+		return (positions[triangle[0]] + positions[triangle[1]] + positions[triangle[2]]) / 3.0f;
+	}
+
+	// bounding sphere around the center of the bounding box, normal cone of the triangles
+	void bound(Meshlets::Meshlet& meshlet, const uint32_t* indices, const glm::vec3* positions)
+	{
+		glm::vec3 lo = positions[indices[0]], hi = lo;
+		glm::vec3 normals(0.0f);
+		for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+		{
+			const uint32_t* triangle = indices + 3 * t;
+			for (int k = 0; k < 3; k++)
+			{
+				lo = glm::min(lo, positions[triangle[k]]);
+				hi = glm::max(hi, positions[triangle[k]]);
+			}
+			glm::vec3 n = glm::cross(positions[triangle[1]] - positions[triangle[0]], positions[triangle[2]] - positions[triangle[0]]);
+			float length = glm::length(n);
+			if (length > 0.0f)
+			{
+				normals += n / length;
+			}
+		}
+
+		meshlet.center = (lo + hi) * 0.5f;
+		meshlet.radius = 0.0f;
+		for (uint32_t i = 0; i < meshlet.triangleCount * 3; i++)
+		{
+			meshlet.radius = glm::max(meshlet.radius, glm::distance(meshlet.center, positions[indices[i]]));
+		}
+
+		meshlet.coneAxis = glm::vec3(0.0f);
+		meshlet.coneCutoff = 1.0f;
+		float length = glm::length(normals);
+		if (length == 0.0f)
+		{
+			return;
+		}
+		meshlet.coneAxis = normals / length;
+
+		float minDot = 1.0f;
+		for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+		{
+			const uint32_t* triangle = indices + 3 * t;
+			glm::vec3 n = glm::cross(positions[triangle[1]] - positions[triangle[0]], positions[triangle[2]] - positions[triangle[0]]);
+			float l = glm::length(n);
+			if (l > 0.0f)
+			{
+				minDot = glm::min(minDot, glm::dot(meshlet.coneAxis, n / l));
+			}
+		}
+
+		// half angle near 90 degrees: back-facing from almost nowhere, not worth the test
+		if (minDot > 0.1f)
+		{
+			// the meshlet faces away if the view direction is within 90 degrees - half angle of the axis
+			meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+		}
+	}
+
+	GeometryPool::DrawCommand command(const Meshlets::Meshlet& meshlet, GLuint firstIndex, GLint baseVertex)
+	{
+		GeometryPool::DrawCommand command;
+		command.count         = meshlet.triangleCount * 3;
+		command.instanceCount = 1;
+		command.firstIndex    = meshlet.firstIndex + firstIndex;
+		command.baseVertex    = baseVertex;
+		command.baseInstance  = 0;
+		return command;
+	}
+}
+
+Meshlets::Meshlets(void)
+: meshes(1, 0)
+{
+}
+
+size_t Meshlets::add(uint32_t* indices, size_t count, const glm::vec3* positions, size_t vertexCount, uint32_t firstIndex,
+	unsigned maxVertices, unsigned maxTriangles)
+{
+	const size_t triangleCount = count / 3;
+
+	// triangles of every vertex: counting sort by vertex
+	std::vector<uint32_t> first(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		first[indices[i] + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		first[v + 1] += first[v];
+	}
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacency[fill[indices[i]]++] = uint32_t(i / 3);
+	}
+
+	std::vector<bool>     emitted(triangleCount, false);
+	std::vector<uint32_t> stamp(vertexCount, 0); // number of the last meshlet using the vertex
+	std::vector<uint32_t> candidates;            // triangles around the vertices of the meshlet, may repeat
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+
+	uint32_t number = 0;
+	uint32_t cursor = 0; // next triangle for the linear search when the last meshlet has no neighbours left
+	size_t   done = 0;
+	glm::vec3 previous(0.0f); // center of the last meshlet
+
+	while (done < triangleCount)
+	{
+		// seed: the neighbour of the last meshlet closest to its center, so the meshlets stay compact
+		uint32_t t = NONE;
+		float nearest = std::numeric_limits<float>::max();
+		for (uint32_t c : candidates)
+		{
+			float d = emitted[c] ? nearest : glm::distance(centroid(indices + 3 * c, positions), previous);
+			if (d < nearest)
+			{
+				nearest = d;
+				t = c;
+			}
+		}
+		while (t == NONE)
+		{
+			if (!emitted[cursor])
+			{
+				t = cursor;
+			}
+			cursor++;
+		}
+
+		Meshlet meshlet;
+		meshlet.firstIndex = firstIndex + uint32_t(output.size());
+		meshlet.triangleCount = 0;
+		meshlet.vertexCount = 0;
+		number++;
+		candidates.clear();
+		glm::vec3 sum(0.0f);
+
+		while (t != NONE)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t v = indices[3 * t + k];
+				if (stamp[v] != number)
+				{
+					stamp[v] = number;
+					meshlet.vertexCount++;
+					sum += positions[v];
+					candidates.insert(candidates.end(), adjacency.begin() + first[v], adjacency.begin() + first[v + 1]);
+				}
+				output.push_back(v);
+			}
+			emitted[t] = true;
+			done++;
+			if (++meshlet.triangleCount == maxTriangles)
+			{
+				break;
+			}
+
+			// next: fewest new vertices, then closest to the center
+			const glm::vec3 center = sum / float(meshlet.vertexCount);
+			t = NONE;
+			unsigned fewest = 4;
+			float closest = 0.0f;
+			size_t kept = 0;
+			for (uint32_t c : candidates)
+			{
+				if (emitted[c])
+				{
+					continue;
+				}
+				candidates[kept++] = c;
+
+				const uint32_t* triangle = indices + 3 * c;
+				unsigned added = (stamp[triangle[0]] != number) + (stamp[triangle[1]] != number) + (stamp[triangle[2]] != number);
+				if (meshlet.vertexCount + added > maxVertices || added > fewest)
+				{
+					continue;
+				}
+				float d = glm::distance(centroid(triangle, positions), center);
+				if (added < fewest || d < closest)
+				{
+					fewest = added;
+					closest = d;
+					t = c;
+				}
+			}
+			candidates.resize(kept);
+		}
+
+		bound(meshlet, output.data() + (meshlet.firstIndex - firstIndex), positions);
+		previous = sum / float(meshlet.vertexCount);
+		push(meshlet);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+	meshes.push_back(meshlets.size());
+	return meshes.size() - 2;
+}
+
+void Meshlets::push(const Meshlet& meshlet)
+{
+	size_t id = meshlets.size();
+	meshlets.push_back(meshlet);
+
+	// 3 floats of padding after the last meshlet, four can be loaded from any meshlet
+	for (std::vector<float>* soa : { &x, &y, &z, &r, &ax, &ay, &az, &cutoff })
+	{
+		soa->resize(id + 4, 0.0f);
+	}
+	x[id] = meshlet.center.x;
+	y[id] = meshlet.center.y;
+	z[id] = meshlet.center.z;
+	r[id] = meshlet.radius;
+	ax[id] = meshlet.coneAxis.x;
+	ay[id] = meshlet.coneAxis.y;
+	az[id] = meshlet.coneAxis.z;
+	cutoff[id] = meshlet.coneCutoff;
+}
+
+bool Meshlets::isBackFacing(const Meshlet& meshlet, const glm::vec3& camera)
+{
+	// every view direction to the bounding sphere lies within the cone around the axis (Zeux, meshoptimizer)
+	glm::vec3 v = meshlet.center - camera;
+	return glm::dot(v, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(v) + meshlet.radius;
+}
+
+void Meshlets::cullScalar(size_t mesh, const Frustum& frustum, const glm::vec3& camera, std::vector<GeometryPool::DrawCommand>& commands,
+	GLuint firstIndex, GLint baseVertex) const
+{
+	for (size_t i = meshes[mesh]; i < meshes[mesh + 1]; i++)
+	{
+		const Meshlet& meshlet = meshlets[i];
+		if (frustum.isVisible(meshlet.center, meshlet.radius) && !isBackFacing(meshlet, camera))
+		{
+			commands.push_back(command(meshlet, firstIndex, baseVertex));
+		}
+	}
+}
+
+void Meshlets::cull(size_t mesh, const Frustum& frustum, const glm::vec3& camera, std::vector<GeometryPool::DrawCommand>& commands,
+	GLuint firstIndex, GLint baseVertex) const
+{
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+	const size_t end = meshes[mesh + 1];
+
+	glm_vec4 planes[6][4]; // broadcast plane components
+	for (int p = 0; p < 6; p++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			planes[p][c] = _mm_set1_ps(frustum.plane(p)[c]);
+		}
+	}
+	const glm_vec4 ex = _mm_set1_ps(camera.x);
+	const glm_vec4 ey = _mm_set1_ps(camera.y);
+	const glm_vec4 ez = _mm_set1_ps(camera.z);
+
+	for (size_t i = meshes[mesh]; i < end; i += 4)
+	{
+		glm_vec4 px = _mm_loadu_ps(&x[i]);
+		glm_vec4 py = _mm_loadu_ps(&y[i]);
+		glm_vec4 pz = _mm_loadu_ps(&z[i]);
+		glm_vec4 pr = _mm_loadu_ps(&r[i]);
+		glm_vec4 nr = glm_vec4_sub(_mm_setzero_ps(), pr);
+
+		// bit k set: meshlet i + k is not outside any plane tested so far
+		int visible = 0xF;
+		for (int p = 0; p < 6 && visible; p++)
+		{
+			glm_vec4 d = glm_vec4_fma(px, planes[p][0], planes[p][3]);
+			d = glm_vec4_fma(py, planes[p][1], d);
+			d = glm_vec4_fma(pz, planes[p][2], d);
+			visible &= ~_mm_movemask_ps(_mm_cmplt_ps(d, nr));
+		}
+		if (!visible)
+		{
+			continue;
+		}
+
+		// back-facing: dot(v, axis) >= cutoff * |v| + radius with v = center - camera
+		glm_vec4 vx = glm_vec4_sub(px, ex);
+		glm_vec4 vy = glm_vec4_sub(py, ey);
+		glm_vec4 vz = glm_vec4_sub(pz, ez);
+		glm_vec4 d = glm_vec4_mul(vx, _mm_loadu_ps(&ax[i]));
+		d = glm_vec4_fma(vy, _mm_loadu_ps(&ay[i]), d);
+		d = glm_vec4_fma(vz, _mm_loadu_ps(&az[i]), d);
+		glm_vec4 length = _mm_sqrt_ps(glm_vec4_fma(vz, vz, glm_vec4_fma(vy, vy, glm_vec4_mul(vx, vx))));
+		visible &= ~_mm_movemask_ps(_mm_cmpge_ps(d, glm_vec4_fma(_mm_loadu_ps(&cutoff[i]), length, pr)));
+
+		for (int k = 0; k < 4; k++)
+		{
+			if ((visible & (1 << k)) && i + k < end)
+			{
+				commands.push_back(command(meshlets[i + k], firstIndex, baseVertex));
+			}
+		}
+	}
+#else
+	cullScalar(mesh, frustum, camera, commands, firstIndex, baseVertex);
+#endif
+}
+
+const Meshlets::Meshlet& Meshlets::meshlet(size_t id) const
+{
+	return meshlets[id];
+}
+
+size_t Meshlets::first(size_t mesh) const
+{
+	return meshes[mesh];
+}
+
+size_t Meshlets::meshCount(void) const
+{
+	return meshes.size() - 1;
+}
+
+size_t Meshlets::size(void) const
+{
+	return meshlets.size();
+}
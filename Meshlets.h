@@ -0,0 +1,79 @@
+#pragma once
+
+#ifndef MESHLETS_H
+#define MESHLETS_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "Frustum.h"
+#include "GeometryPool.h"
+
+namespace cg
+{
+	/*
+	 Partition of indexed triangle meshes into meshlets (clusters) of at most 64 vertices and
+	 124 triangles. add reorders the triangles so every meshlet is a consecutive index range and
+	 can be drawn without any other change to the mesh. The meshlets grow over shared vertices,
+	 preferring triangles that add few vertices and lie close to the meshlet center.
+	 Every meshlet gets a bounding sphere and a normal cone: it is skipped if it is outside the
+	 frustum or all of its triangles face away from the camera, so the back half of a large
+	 mesh costs no vertex work. With SSE2 (GLM_ARCH_SSE2_BIT) four meshlets are tested at once.
+	 The surviving meshlets become glMultiDrawElementsIndirect commands (GeometryPool::DrawCommand).
+
+	 PROTOCOL
+	 this->add  // for every mesh with its position in the index buffer, returns the mesh id
+	 this->cull // every frame with the frustum and the camera in model space
+	*/
+	class Meshlets
+	{
+	public:
+		static const unsigned MAX_VERTICES = 64;
+		static const unsigned MAX_TRIANGLES = 124;
+
+		struct Meshlet
+		{
+			uint32_t  firstIndex;    // in the index buffer, the triangles of a meshlet are consecutive
+			uint32_t  triangleCount;
+			uint32_t  vertexCount;   // distinct vertices
+			glm::vec3 center;        // bounding sphere
+			float     radius;
+			glm::vec3 coneAxis;      // average triangle normal
+			float     coneCutoff;    // sin of the cone half angle, 1 if the cone is too wide to cull
+		};
+
+		Meshlets(void);
+
+		// Reorders the triangles of indices (counter-clockwise front faces) into meshlets.
+		// firstIndex: position of indices[0] in the index buffer the meshlets are drawn from.
+		size_t add(uint32_t* indices, size_t count, const glm::vec3* positions, size_t vertexCount, uint32_t firstIndex = 0,
+			unsigned maxVertices = MAX_VERTICES, unsigned maxTriangles = MAX_TRIANGLES);
+
+		// Appends one command per visible meshlet of mesh, commands get firstIndex and baseVertex added.
+		void cull(size_t mesh, const Frustum& frustum, const glm::vec3& camera, std::vector<GeometryPool::DrawCommand>& commands,
+			GLuint firstIndex = 0, GLint baseVertex = 0) const;       // SIMD if available
+		void cullScalar(size_t mesh, const Frustum& frustum, const glm::vec3& camera, std::vector<GeometryPool::DrawCommand>& commands,
+			GLuint firstIndex = 0, GLint baseVertex = 0) const;       // reference
+
+		static bool isBackFacing(const Meshlet& meshlet, const glm::vec3& camera);
+
+		const Meshlet& meshlet(size_t id) const;
+		size_t first(size_t mesh) const; // meshlets first(mesh) .. first(mesh + 1) - 1 belong to mesh
+		size_t meshCount(void) const;
+		size_t size(void) const;         // meshlets of all meshes
+
+	private:
+		void push(const Meshlet& meshlet);
+
+		std::vector<Meshlet> meshlets;
+		std::vector<size_t>  meshes; // first meshlet of every mesh and the end
+
+		// SoA copy for the culling, 3 floats of padding at the end (never reported visible)
+		std::vector<float> x, y, z, r, ax, ay, az, cutoff;
+	};
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include "RenderQueue.h"
+
+#include "GLState.h"
+
+using namespace cg;
+
+RenderQueue::RenderQueue(void)
+: stats()
+{
+}
+
+void RenderQueue::clear(void)
+{
+	packets.clear();
+	items.clear();
+}
+
+uint32_t RenderQueue::id(std::unordered_map<uintptr_t, uint32_t>& ids, uintptr_t object)
+{
+	auto it = ids.find(object);
+
+	if (it == ids.end())
+	{
+		it = ids.emplace(object, uint32_t(ids.size())).first;
+	}
+
+	return it->second;
+}
+
+uint64_t RenderQueue::makeKey(uint32_t program, uint32_t vao, uint32_t material, float depth)
+{
+	uint64_t d = uint64_t(glm::clamp(depth, 0.0f, 1.0f) * float(0xFFFFFF));
+
+	return (uint64_t(program  & 0xFFF)  << 52)
+		 | (uint64_t(vao      & 0xFFFF) << 36)
+		 | (uint64_t(material & 0xFFF)  << 24)
+		 | d;
+}
+
+void RenderQueue::add(const Packet& packet, uint16_t material, float depth)
+{
+	uint32_t program = id(programIds, reinterpret_cast<uintptr_t>(packet.program));
+	uint32_t vao     = id(vaoIds, packet.vao);
+
+	items.push_back({ makeKey(program, vao, material, depth), uint32_t(packets.size()) });
+	packets.push_back(packet);
+}
+
+void RenderQueue::radixSort(std::vector<std::pair<uint64_t, uint32_t>>& items,
+	std::vector<std::pair<uint64_t, uint32_t>>& scratch)
+{
+	scratch.resize(items.size());
+
+	// LSD, 8 bit digits; digits that are equal for all keys are skipped
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		size_t count[256] = { 0 };
+
+		for (const auto& item : items)
+		{
+			count[(item.first >> shift) & 0xFF]++;
+		}
+
+		if (count[(items.empty() ? 0 : items[0].first >> shift) & 0xFF] == items.size())
+		{
+			continue;
+		}
+
+		size_t offset = 0;
+		for (size_t& c : count)
+		{
+			size_t n = c;
+			c = offset;
+			offset += n;
+		}
+
+		for (const auto& item : items)
+		{
+			scratch[count[(item.first >> shift) & 0xFF]++] = item;
+		}
+
+		items.swap(scratch);
+	}
+}
+
+void RenderQueue::sort(void)
+{
+	radixSort(items, scratch);
+}
+
+void RenderQueue::execute(void)
+{
+	stats = Stats();
+	stats.packets = items.size();
+
+	GLSLProgram* program = nullptr;
+	GLuint vao = 0;
+	bool first = true;
+
+	for (const auto& item : items)
+	{
+		const Packet& packet = packets[item.second];
+
+		if (first || packet.program != program)
+		{
+			packet.program->use();
+			program = packet.program;
+			stats.programBinds++;
+		}
+		else
+		{
+			stats.programSkipped++;
+		}
+
+		if (first || packet.vao != vao)
+		{
+			GLState::bindVertexArray(packet.vao);
+			vao = packet.vao;
+			stats.vaoBinds++;
+		}
+		else
+		{
+			stats.vaoSkipped++;
+		}
+		first = false;
+
+		program->setUniform("model", packet.model);
+
+		if (packet.indexBuffer)
+		{
+			packet.indexBuffer->draw(packet.mesh, packet.mode);
+		}
+		else
+		{
+			glDrawArrays(packet.mode, packet.first, packet.count);
+		}
+	}
+}
+
+const RenderQueue::Stats& RenderQueue::getStats(void) const
+{
+	return stats;
+}
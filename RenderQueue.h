@@ -0,0 +1,81 @@
+#pragma once
+
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include <GL/glew.h>
+
+#include "GLSLProgram.h"
+#include "IndexBuffer.h"
+
+namespace cg
+{
+	/*
+	 Collects the draws of a frame, sorts them by a 64 bit key and submits them with as few
+	 program and VAO changes as possible.
+	 key (most significant first): program 12 bit | VAO 16 bit | material 12 bit | depth 24 bit
+	 Programs and VAOs get dense ids in the order they are first seen (kept across frames).
+	 Every packet sets the uniform "model" (GLSLProgram skips unchanged values).
+
+	 PROTOCOL (every frame)
+	 this->clear
+	 this->add            // for every draw
+	 this->sort           // radix sort of the keys
+	 this->execute        // draws, this->getStats for the counters of the frame
+	*/
+	class RenderQueue
+	{
+	public:
+		struct Packet
+		{
+			GLSLProgram* program;
+			GLuint vao;
+			const IndexBuffer* indexBuffer; // nullptr: glDrawArrays(mode, first, count)
+			size_t mesh;                    // of indexBuffer
+			GLenum mode;
+			GLint first;
+			GLsizei count;
+			glm::mat4 model;
+		};
+
+		struct Stats
+		{
+			unsigned long packets;
+			unsigned long programBinds;   // glUseProgram calls
+			unsigned long programSkipped; // redundant glUseProgram calls elided
+			unsigned long vaoBinds;       // glBindVertexArray calls
+			unsigned long vaoSkipped;     // redundant glBindVertexArray calls elided
+		};
+
+		RenderQueue(void);
+
+		void clear(void);
+		void add(const Packet& packet, uint16_t material = 0, float depth = 0.0f); // depth in [0, 1], front first
+		void sort(void);
+		void execute(void);
+
+		const Stats& getStats(void) const; // of the last execute
+
+		static uint64_t makeKey(uint32_t program, uint32_t vao, uint32_t material, float depth);
+		static void radixSort(std::vector<std::pair<uint64_t, uint32_t>>& items,
+			std::vector<std::pair<uint64_t, uint32_t>>& scratch); // by key, stable
+
+	private:
+		uint32_t id(std::unordered_map<uintptr_t, uint32_t>& ids, uintptr_t object);
+
+		std::vector<Packet> packets;
+		std::vector<std::pair<uint64_t, uint32_t>> items;   // key, packet index
+		std::vector<std::pair<uint64_t, uint32_t>> scratch; // radix sort buffer
+		std::unordered_map<uintptr_t, uint32_t> programIds;
+		std::unordered_map<uintptr_t, uint32_t> vaoIds;
+		Stats stats;
+	};
+};
+
+#endif
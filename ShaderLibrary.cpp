@@ -0,0 +1,292 @@
+#include "ShaderLibrary.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+
+#include "GLSLProgram.h"
+
+using namespace cg;
+
+namespace
+{
+	// Directive name if the line is "  #  name ...", position of the rest in pos.
+	std::string directive(const std::string& line, size_t& pos)
+	{
+		pos = line.find_first_not_of(" \t");
+		if (pos == std::string::npos || line[pos] != '#')
+		{
+			return "";
+		}
+
+		size_t begin = line.find_first_not_of(" \t", pos + 1);
+		if (begin == std::string::npos)
+		{
+			return "";
+		}
+
+		pos = begin;
+		while (pos < line.size() && isalpha(static_cast<unsigned char>(line[pos])))
+		{
+			pos++;
+		}
+		return line.substr(begin, pos - begin);
+	}
+}
+
+ShaderLibrary::ShaderLibrary(void)
+: reads(0)
+{
+}
+
+void ShaderLibrary::addIncludePath(const std::string& directory)
+{
+	if (directory.empty() || directory.back() == '/' || directory.back() == '\\')
+	{
+		includePaths.push_back(directory);
+	}
+	else
+	{
+		includePaths.push_back(directory + "/");
+	}
+}
+
+const std::string& ShaderLibrary::log(void) const
+{
+	return logString;
+}
+
+void ShaderLibrary::clear(void)
+{
+	files.clear();
+	reads = 0;
+}
+
+size_t ShaderLibrary::fileReads(void) const
+{
+	return reads;
+}
+
+ShaderLibrary& ShaderLibrary::shared(void)
+{
+	static ShaderLibrary library;
+	return library;
+}
+
+const ShaderLibrary::File* ShaderLibrary::load(const std::string& path)
+{
+	auto it = files.find(path);
+	if (it != files.end())
+	{
+		return it->second.get();
+	}
+
+	std::string content;
+	if (!GLSLProgram::loadFile(path.c_str(), content))
+	{
+		return nullptr;
+	}
+	reads++;
+
+	std::unique_ptr<File> file(new File());
+	file->path    = path;
+	file->hash    = GLSLProgram::hash(content.data(), content.size());
+	file->version = 0;
+
+	// the last line must end before a following #line directive
+	if (!content.empty() && content.back() != '\n')
+	{
+		content += '\n';
+	}
+
+	size_t slash = path.find_last_of("/\\");
+	file->directory = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+
+	// Split at #include and #version lines, everything else is copied unchanged.
+	Segment text = { Segment::TEXT, "", 0 };
+	int lineNumber = 0;
+
+	for (size_t begin = 0; begin < content.size(); )
+	{
+		size_t end = content.find('\n', begin);
+		end = end == std::string::npos ? content.size() : end + 1;
+		const std::string line = content.substr(begin, end - begin);
+		begin = end;
+		lineNumber++;
+
+		size_t pos;
+		std::string name = directive(line, pos);
+
+		if (name == "include")
+		{
+			size_t open  = line.find_first_of("\"<", pos);
+			size_t close = open == std::string::npos ? open : line.find_first_of("\">", open + 1);
+
+			if (close == std::string::npos)
+			{
+				logString = path + "(" + std::to_string(lineNumber) + "): malformed #include";
+				return nullptr;
+			}
+
+			if (!text.text.empty())
+			{
+				file->segments.push_back(text);
+				text.text.clear();
+			}
+
+			Segment include = { Segment::INCLUDE, line.substr(open + 1, close - open - 1), lineNumber + 1 };
+			file->segments.push_back(include);
+		}
+		else if (name == "version")
+		{
+			if (!text.text.empty())
+			{
+				file->segments.push_back(text);
+				text.text.clear();
+			}
+
+			file->version = std::atoi(line.c_str() + pos);
+			Segment version = { Segment::VERSION, line, 0 };
+			file->segments.push_back(version);
+		}
+		else
+		{
+			text.text += line;
+		}
+	}
+
+	if (!text.text.empty())
+	{
+		file->segments.push_back(text);
+	}
+
+	const File* result = file.get();
+	files[path] = std::move(file);
+	return result;
+}
+
+std::string ShaderLibrary::resolve(const File& from, const std::string& name) const
+{
+	std::string path = from.directory + name;
+	if (files.count(path) > 0 || std::ifstream(path).good())
+	{
+		return path;
+	}
+
+	for (const std::string& directory : includePaths)
+	{
+		path = directory + name;
+		if (files.count(path) > 0 || std::ifstream(path).good())
+		{
+			return path;
+		}
+	}
+
+	return "";
+}
+
+std::string ShaderLibrary::lineDirective(int line, size_t source, int version) const
+{
+	// Up to GLSL 4.10 "#line n" numbers the line after the directive n + 1, since 4.20 n.
+	int number = version >= 420 ? line : line - 1;
+	return "#line " + std::to_string(number) + " " + std::to_string(source) + "\n";
+}
+
+bool ShaderLibrary::expand(const std::string& filename, Expansion& expansion)
+{
+	logString.clear();
+	expansion.source.clear();
+	expansion.files.clear();
+	expansion.hash = GLSLProgram::hash(nullptr, 0);
+
+	const File* root = load(filename);
+	if (root == nullptr)
+	{
+		if (logString.empty())
+		{
+			logString = "could not open file \"" + filename + "\"";
+		}
+		return false;
+	}
+
+	State state;
+	state.expansion = &expansion;
+	state.version   = root->version;
+
+	return expand(*root, state);
+}
+
+bool ShaderLibrary::expand(const File& file, State& state)
+{
+	Expansion& expansion = *state.expansion;
+	const size_t source = expansion.files.size();
+	const bool root = state.stack.empty();
+
+	expansion.files.push_back(file.path);
+	expansion.hash = GLSLProgram::hash(&file.hash, sizeof(file.hash), expansion.hash);
+	state.stack.push_back(&file);
+	state.done.push_back(&file);
+
+	if (!root)
+	{
+		expansion.source += lineDirective(1, source, state.version);
+	}
+
+	for (const Segment& segment : file.segments)
+	{
+		switch (segment.kind)
+		{
+		case Segment::TEXT:
+			expansion.source += segment.text;
+			break;
+
+		case Segment::VERSION:
+			// only the root may declare the version, keep the line count of included files
+			expansion.source += root ? segment.text : "\n";
+			break;
+
+		case Segment::INCLUDE:
+		{
+			std::string path = resolve(file, segment.text);
+			const File* included = path.empty() ? nullptr : load(path);
+
+			if (included == nullptr)
+			{
+				if (logString.empty())
+				{
+					logString = file.path + "(" + std::to_string(segment.nextLine - 1) + "): could not include \"" + segment.text + "\"";
+				}
+				return false;
+			}
+
+			if (std::find(state.stack.begin(), state.stack.end(), included) != state.stack.end())
+			{
+				logString = "include cycle:";
+				for (const File* f : state.stack)
+				{
+					logString += " " + f->path + " ->";
+				}
+				logString += " " + included->path;
+				return false;
+			}
+
+			if (std::find(state.done.begin(), state.done.end(), included) != state.done.end())
+			{
+				expansion.source += "\n"; // already included
+				break;
+			}
+
+			if (!expand(*included, state))
+			{
+				return false;
+			}
+
+			expansion.source += lineDirective(segment.nextLine, source, state.version);
+			break;
+		}
+		}
+	}
+
+	state.stack.pop_back();
+	return true;
+}
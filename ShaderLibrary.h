@@ -0,0 +1,88 @@
+#pragma once
+
+#ifndef SHADERLIBRARY_H
+#define SHADERLIBRARY_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+
+namespace cg
+{
+	/*
+	 #include resolver for GLSL files. Every file is read, split at its #include lines and hashed
+	 only once; expansions of many shaders share the parsed files.
+	 #include "file" is searched relative to the including file, then in the include paths.
+	 A file is included only once per expansion (like #pragma once), cycles are an error.
+	 Every file gets its own source string number: #line directives keep compile logs pointing
+	 to the right file and line, Expansion::files maps the numbers back to file names.
+
+	 USAGE
+	 ShaderLibrary::shared().addIncludePath("shader") // optional
+	 ShaderLibrary::shared().expand("shader/simple.vert", expansion)
+	 glShaderSource(expansion.source), expansion.hash as cache key of the source
+	*/
+	class ShaderLibrary
+	{
+	public:
+		struct Expansion
+		{
+			std::string source;             // ready for glShaderSource
+			uint64_t hash;                  // hash of all contributing files, in include order
+			std::vector<std::string> files; // source string number -> file name
+		};
+
+		ShaderLibrary(void);
+
+		void addIncludePath(const std::string& directory);
+
+		bool expand(const std::string& filename, Expansion& expansion); // false: see log
+		const std::string& log(void) const;
+
+		void clear(void);               // forget all parsed files, e.g. to reload changed shaders
+		size_t fileReads(void) const;   // number of files read from disk since the last clear
+
+		static ShaderLibrary& shared(void); // process wide instance used by GLSLProgram::compileShaderFromFile
+
+	private:
+		struct Segment
+		{
+			enum Kind { TEXT, INCLUDE, VERSION };
+
+			Kind kind;
+			std::string text;    // TEXT, VERSION: lines including the new-lines; INCLUDE: file name
+			int nextLine;        // INCLUDE: line number after the directive
+		};
+
+		struct File
+		{
+			std::string path;
+			std::string directory;         // with trailing '/', empty for the working directory
+			uint64_t hash;                 // of the file content
+			int version;                   // from #version, 0 if there is none
+			std::vector<Segment> segments; // the file in order
+		};
+
+		struct State
+		{
+			Expansion* expansion;
+			std::vector<const File*> stack;  // files being expanded, for cycle detection
+			std::vector<const File*> done;   // files already included once
+			int version;                     // #version of the root file
+		};
+
+		const File* load(const std::string& path); // parsed file from the cache or disk, nullptr if not found
+		std::string resolve(const File& from, const std::string& name) const;
+		bool expand(const File& file, State& state);
+		std::string lineDirective(int line, size_t source, int version) const;
+
+		std::vector<std::string> includePaths;
+		std::unordered_map<std::string, std::unique_ptr<File>> files; // by path
+		std::string logString;
+		size_t reads;
+	};
+};
+
+#endif
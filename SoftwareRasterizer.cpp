@@ -0,0 +1,558 @@
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <thread>
+#include <cmath>
+
+#include <glm/simd/common.h>
+
+using namespace cg;
+
+const int SoftwareRasterizer::TILE_SIZE;
+
+namespace
+{
+	const size_t PARALLEL_TRIANGLES = 16384; // smaller draws are set up by the calling thread
+	const float  GUARD_BAND = 8192.0f;       // pixels from the viewport center, keeps the edge functions in 32 bit per tile
+	const int    SUBPIXELS = 16;             // snapping of the window coordinates
+
+	// work(slice) for every slice in its own thread, the last one in the calling thread
+	template <typename Work>
+	void parallel(unsigned slices, const Work& work)
+	{
+		std::vector<std::thread> threads;
+		for (unsigned slice = 0; slice + 1 < slices; slice++)
+		{
+			threads.emplace_back(work, slice);
+		}
+		work(slices - 1);
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	uint32_t rgba8(const glm::vec3& color)
+	{
+		glm::uvec3 c = glm::uvec3(glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f);
+		return c.r | (c.g << 8) | (c.b << 16) | 0xFF000000u;
+	}
+}
+
+SoftwareRasterizer::SoftwareRasterizer(int width, int height, unsigned threads)
+: width(0)
+, height(0)
+, stride(0)
+, tilesX(0)
+, tilesY(0)
+, threads(1)
+, clearPending(false)
+, clearColor(0xFF000000u)
+, clearDepth(1.0f)
+, batchCount(0)
+{
+	resize(width, height);
+	setThreads(threads);
+	statistics = Statistics();
+}
+
+void SoftwareRasterizer::resize(int w, int h)
+{
+	// the guard band has to contain the viewport
+	width  = glm::clamp(w, 1, int(GUARD_BAND));
+	height = glm::clamp(h, 1, int(GUARD_BAND));
+	stride = (width + 3) & ~3;
+
+	const float gx = 2.0f * GUARD_BAND / float(width), gy = 2.0f * GUARD_BAND / float(height);
+	planes[0] = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	planes[1] = glm::vec4(0.0f, 0.0f, -1.0f, 1.0f);
+	planes[2] = glm::vec4(1.0f, 0.0f, 0.0f, gx);
+	planes[3] = glm::vec4(-1.0f, 0.0f, 0.0f, gx);
+	planes[4] = glm::vec4(0.0f, 1.0f, 0.0f, gy);
+	planes[5] = glm::vec4(0.0f, -1.0f, 0.0f, gy);
+	planes[6] = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+	planes[7] = glm::vec4(-1.0f, 0.0f, 0.0f, 1.0f);
+	planes[8] = glm::vec4(0.0f, 1.0f, 0.0f, 1.0f);
+	planes[9] = glm::vec4(0.0f, -1.0f, 0.0f, 1.0f);
+
+	tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	colors.assign(size_t(stride) * height, clearColor);
+	depths.assign(size_t(stride) * height, clearDepth);
+	batchCount = 0;
+}
+
+void SoftwareRasterizer::setThreads(unsigned count)
+{
+	threads = count > 0 ? count : std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+void SoftwareRasterizer::clear(const glm::vec3& color, float depth)
+{
+	clearPending = true;
+	clearColor = rgba8(color);
+	clearDepth = depth;
+	statistics = Statistics();
+}
+
+void SoftwareRasterizer::draw(const glm::mat4& mvp, const glm::vec3* positions, const glm::vec3* colors, size_t vertexCount,
+	const uint32_t* indices, size_t indexCount)
+{
+	drawIndexed(mvp, positions, colors, vertexCount, indices, indexCount);
+}
+
+void SoftwareRasterizer::draw(const glm::mat4& mvp, const glm::vec3* positions, const glm::vec3* colors, size_t vertexCount,
+	const uint16_t* indices, size_t indexCount)
+{
+	drawIndexed(mvp, positions, colors, vertexCount, indices, indexCount);
+}
+
+template <typename Index>
+void SoftwareRasterizer::drawIndexed(const glm::mat4& mvp, const glm::vec3* positions, const glm::vec3* vertexColors, size_t vertexCount,
+	const Index* indices, size_t indexCount)
+{
+	const size_t triangleCount = indexCount / 3;
+	const unsigned slices = triangleCount >= PARALLEL_TRIANGLES ? threads : 1;
+	statistics.triangles += triangleCount;
+
+	vertices.resize(vertexCount);
+	if (batches.size() < batchCount + slices)
+	{
+		batches.resize(batchCount + slices);
+	}
+
+	parallel(slices, [&](unsigned slice)
+	{
+		for (size_t i = vertexCount * slice / slices; i < vertexCount * (slice + 1) / slices; i++)
+		{
+			Vertex& v = vertices[i];
+			v.position = mvp * glm::vec4(positions[i], 1.0f);
+			v.color = vertexColors[i];
+			v.outside = 0;
+			for (int p = 0; p < 10; p++)
+			{
+				v.outside |= glm::dot(planes[p], v.position) < 0.0f ? 1 << p : 0;
+			}
+			if (!(v.outside & 0x3F))
+			{
+				v.window = project(v.position, v.color);
+			}
+		}
+	});
+
+	parallel(slices, [&](unsigned slice)
+	{
+		Batch& batch = batches[batchCount + slice];
+		batch.triangles.clear();
+		for (size_t t = triangleCount * slice / slices; t < triangleCount * (slice + 1) / slices; t++)
+		{
+			setup(vertices[indices[3 * t]], vertices[indices[3 * t + 1]], vertices[indices[3 * t + 2]], batch.triangles);
+		}
+		bin(batch);
+	});
+
+	for (unsigned slice = 0; slice < slices; slice++)
+	{
+		statistics.rasterized += batches[batchCount + slice].triangles.size();
+	}
+	batchCount += slices;
+}
+
+SoftwareRasterizer::Window SoftwareRasterizer::project(const glm::vec4& position, const glm::vec3& color) const
+{
+	Window window;
+	window.w = 1.0f / position.w;
+	window.x = int64_t(std::floor((position.x * window.w * 0.5f + 0.5f) * float(width) * SUBPIXELS + 0.5f));
+	window.y = int64_t(std::floor((position.y * window.w * 0.5f + 0.5f) * float(height) * SUBPIXELS + 0.5f));
+	window.z = position.z * window.w * 0.5f + 0.5f;
+	window.color = color * window.w;
+	return window;
+}
+
+void SoftwareRasterizer::setup(const Vertex& v0, const Vertex& v1, const Vertex& v2, std::vector<Triangle>& triangles) const
+{
+	const int outsideAll = v0.outside & v1.outside & v2.outside;
+	const int outsideAny = v0.outside | v1.outside | v2.outside;
+	if (outsideAll)
+	{
+		return;
+	}
+	if (!(outsideAny & 0x3F))
+	{
+		setup(&v0.window, &v1.window, &v2.window, triangles);
+		return;
+	}
+
+	// Sutherland-Hodgman, only against the planes that cut the triangle (the viewport is left to the scissor)
+	Vertex polygons[2][9] = { { v0, v1, v2 } };
+	int count = 3;
+	Vertex* polygon = polygons[0];
+	for (int p = 0; p < 6; p++)
+	{
+		if (!(outsideAny & (1 << p)))
+		{
+			continue;
+		}
+		Vertex* clipped = polygon == polygons[0] ? polygons[1] : polygons[0];
+		int clippedCount = 0;
+		for (int i = 0; i < count; i++)
+		{
+			const Vertex& a = polygon[i];
+			const Vertex& b = polygon[(i + 1) % count];
+			float da = glm::dot(planes[p], a.position);
+			float db = glm::dot(planes[p], b.position);
+			if (da >= 0.0f)
+			{
+				clipped[clippedCount++] = a;
+			}
+			if ((da >= 0.0f) != (db >= 0.0f))
+			{
+				float t = da / (da - db);
+				clipped[clippedCount].position = glm::mix(a.position, b.position, t);
+				clipped[clippedCount].color = glm::mix(a.color, b.color, t);
+				clippedCount++;
+			}
+		}
+		polygon = clipped;
+		count = clippedCount;
+	}
+
+	// fan of the clipped polygon
+	Window window[9];
+	for (int i = 0; i < count; i++)
+	{
+		window[i] = project(polygon[i].position, polygon[i].color);
+	}
+	for (int i = 1; i + 1 < count; i++)
+	{
+		setup(&window[0], &window[i], &window[i + 1], triangles);
+	}
+}
+
+void SoftwareRasterizer::setup(const Window* v0, const Window* v1, const Window* v2, std::vector<Triangle>& triangles) const
+{
+	const Window* v[3] = { v0, v1, v2 };
+	int64_t area = (v[1]->x - v[0]->x) * (v[2]->y - v[0]->y) - (v[1]->y - v[0]->y) * (v[2]->x - v[0]->x);
+	if (area == 0)
+	{
+		return;
+	}
+	if (area < 0)
+	{
+		std::swap(v[1], v[2]);
+		area = -area;
+	}
+
+	// pixel centers at 16 x + 8 inside the bounding box
+	Triangle t;
+	int64_t minX = std::min(v[0]->x, std::min(v[1]->x, v[2]->x)), maxX = std::max(v[0]->x, std::max(v[1]->x, v[2]->x));
+	int64_t minY = std::min(v[0]->y, std::min(v[1]->y, v[2]->y)), maxY = std::max(v[0]->y, std::max(v[1]->y, v[2]->y));
+	t.minX = int(std::max<int64_t>((minX - SUBPIXELS / 2 + SUBPIXELS - 1) >> 4, 0));
+	t.minY = int(std::max<int64_t>((minY - SUBPIXELS / 2 + SUBPIXELS - 1) >> 4, 0));
+	t.maxX = int(std::min<int64_t>((maxX - SUBPIXELS / 2) >> 4, width - 1));
+	t.maxY = int(std::min<int64_t>((maxY - SUBPIXELS / 2) >> 4, height - 1));
+	if (t.minX > t.maxX || t.minY > t.maxY)
+	{
+		return;
+	}
+
+	// edge k is opposite of vertex k, >= 0 inside; the top-left rule makes it > 0 for the others
+	for (int k = 0; k < 3; k++)
+	{
+		const Window& a = *v[(k + 1) % 3];
+		const Window& b = *v[(k + 2) % 3];
+		t.a[k] = int32_t(a.y - b.y);
+		t.b[k] = int32_t(b.x - a.x);
+		t.c[k] = a.x * b.y - a.y * b.x;
+		if (!(t.a[k] > 0 || (t.a[k] == 0 && t.b[k] < 0)))
+		{
+			t.c[k] -= 1;
+		}
+	}
+
+	// planes through the snapped vertices
+	t.x0 = float(v[0]->x) / SUBPIXELS;
+	t.y0 = float(v[0]->y) / SUBPIXELS;
+	const float dx1 = float(v[1]->x - v[0]->x) / SUBPIXELS, dy1 = float(v[1]->y - v[0]->y) / SUBPIXELS;
+	const float dx2 = float(v[2]->x - v[0]->x) / SUBPIXELS, dy2 = float(v[2]->y - v[0]->y) / SUBPIXELS;
+	const float invDet = float(SUBPIXELS * SUBPIXELS) / float(area);
+	for (int p = 0; p < 5; p++)
+	{
+		float f[3];
+		for (int k = 0; k < 3; k++)
+		{
+			f[k] = p == 0 ? v[k]->z : (p == 1 ? v[k]->w : v[k]->color[p - 2]);
+		}
+		t.plane[p][0] = f[0];
+		t.plane[p][1] = ((f[1] - f[0]) * dy2 - (f[2] - f[0]) * dy1) * invDet;
+		t.plane[p][2] = ((f[2] - f[0]) * dx1 - (f[1] - f[0]) * dx2) * invDet;
+	}
+	triangles.push_back(t);
+}
+
+void SoftwareRasterizer::bin(Batch& batch) const
+{
+	// counting sort of the (tile, triangle) pairs by tile, triangles stay in order
+	batch.first.assign(size_t(tilesX) * tilesY + 1, 0);
+	for (const Triangle& t : batch.triangles)
+	{
+		for (int ty = t.minY / TILE_SIZE; ty <= t.maxY / TILE_SIZE; ty++)
+		{
+			for (int tx = t.minX / TILE_SIZE; tx <= t.maxX / TILE_SIZE; tx++)
+			{
+				batch.first[ty * tilesX + tx + 1]++;
+			}
+		}
+	}
+	for (size_t tile = 1; tile < batch.first.size(); tile++)
+	{
+		batch.first[tile] += batch.first[tile - 1];
+	}
+
+	batch.ids.resize(batch.first.back());
+	std::vector<uint32_t> fill(batch.first.begin(), batch.first.end() - 1);
+	for (uint32_t id = 0; id < batch.triangles.size(); id++)
+	{
+		const Triangle& t = batch.triangles[id];
+		for (int ty = t.minY / TILE_SIZE; ty <= t.maxY / TILE_SIZE; ty++)
+		{
+			for (int tx = t.minX / TILE_SIZE; tx <= t.maxX / TILE_SIZE; tx++)
+			{
+				batch.ids[fill[ty * tilesX + tx]++] = id;
+			}
+		}
+	}
+}
+
+void SoftwareRasterizer::finish(void)
+{
+	const int tiles = tilesX * tilesY;
+	std::atomic<int> next(0);
+	std::vector<size_t> fragments(threads, 0);
+
+	parallel(threads, [&](unsigned thread)
+	{
+		for (int tile = next++; tile < tiles; tile = next++)
+		{
+			const int x0 = (tile % tilesX) * TILE_SIZE, y0 = (tile / tilesX) * TILE_SIZE;
+			const int x1 = std::min(x0 + TILE_SIZE, width) - 1, y1 = std::min(y0 + TILE_SIZE, height) - 1;
+
+			if (clearPending)
+			{
+				for (int y = y0; y <= y1; y++)
+				{
+					std::fill(&colors[size_t(y) * stride + x0], &colors[size_t(y) * stride + x1] + 1, clearColor);
+					std::fill(&depths[size_t(y) * stride + x0], &depths[size_t(y) * stride + x1] + 1, clearDepth);
+				}
+			}
+
+			for (size_t b = 0; b < batchCount; b++)
+			{
+				const Batch& batch = batches[b];
+				for (uint32_t i = batch.first[tile]; i < batch.first[tile + 1]; i++)
+				{
+					const Triangle& t = batch.triangles[batch.ids[i]];
+					fragments[thread] += rasterize(t, std::max(x0, t.minX), std::max(y0, t.minY), std::min(x1, t.maxX), std::min(y1, t.maxY));
+				}
+			}
+		}
+	});
+
+	for (size_t count : fragments)
+	{
+		statistics.fragments += count;
+	}
+	clearPending = false;
+	batchCount = 0;
+}
+
+size_t SoftwareRasterizer::rasterize(const Triangle& t, int x0, int y0, int x1, int y1)
+{
+	// Edges the rectangle lies completely inside of are not tested. Every other edge crosses
+	// the rectangle, so its values in the tile fit into 32 bit.
+	const int gx0 = x0 & ~3; // groups of 4 pixels, aligned within the tile
+	int32_t e[3], stepX[3], stepY[3]; // at (gx0, y0), per pixel, per row
+	for (int k = 0; k < 3; k++)
+	{
+		auto edge = [&](int x, int y) { return int64_t(t.a[k]) * (SUBPIXELS * x + SUBPIXELS / 2) + int64_t(t.b[k]) * (SUBPIXELS * y + SUBPIXELS / 2) + t.c[k]; };
+		int64_t corners[4] = { edge(x0, y0), edge(x1, y0), edge(x0, y1), edge(x1, y1) };
+		int64_t lo = std::min(std::min(corners[0], corners[1]), std::min(corners[2], corners[3]));
+		int64_t hi = std::max(std::max(corners[0], corners[1]), std::max(corners[2], corners[3]));
+		if (hi < 0)
+		{
+			return 0;
+		}
+		bool inside = lo >= 0;
+		e[k]     = inside ? 0 : int32_t(edge(gx0, y0));
+		stepX[k] = inside ? 0 : t.a[k] * SUBPIXELS;
+		stepY[k] = inside ? 0 : t.b[k] * SUBPIXELS;
+	}
+
+	size_t covered = 0;
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+	const __m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+	const __m128i first = _mm_set1_epi32(x0 - 1);
+	const __m128i last = _mm_set1_epi32(x1 + 1);
+	__m128i laneSteps[3], groupSteps[3];
+	for (int k = 0; k < 3; k++)
+	{
+		laneSteps[k]  = _mm_setr_epi32(0, stepX[k], 2 * stepX[k], 3 * stepX[k]);
+		groupSteps[k] = _mm_set1_epi32(4 * stepX[k]);
+	}
+	const glm_vec4 zero = _mm_setzero_ps();
+	const glm_vec4 one = _mm_set1_ps(1.0f);
+	const glm_vec4 unorm = _mm_set1_ps(255.0f);
+	const glm_vec4 dxLane = glm_vec4_add(_mm_cvtepi32_ps(lane), _mm_set1_ps(0.5f - t.x0));
+
+	for (int y = y0; y <= y1; y++, e[0] += stepY[0], e[1] += stepY[1], e[2] += stepY[2])
+	{
+		__m128i edges[3];
+		for (int k = 0; k < 3; k++)
+		{
+			edges[k] = _mm_add_epi32(_mm_set1_epi32(e[k]), laneSteps[k]);
+		}
+		const float dy = float(y) + 0.5f - t.y0;
+		glm_vec4 rows[5]; // plane values at x = 0 of the row, per component
+		for (int p = 0; p < 5; p++)
+		{
+			rows[p] = _mm_set1_ps(t.plane[p][0] + t.plane[p][2] * dy);
+		}
+
+		for (int x = gx0; x <= x1; x += 4)
+		{
+			__m128i xs = _mm_add_epi32(_mm_set1_epi32(x), lane);
+			__m128i mask = _mm_and_si128(_mm_cmpgt_epi32(xs, first), _mm_cmplt_epi32(xs, last));
+			mask = _mm_andnot_si128(_mm_srai_epi32(_mm_or_si128(_mm_or_si128(edges[0], edges[1]), edges[2]), 31), mask);
+			for (int k = 0; k < 3; k++)
+			{
+				edges[k] = _mm_add_epi32(edges[k], groupSteps[k]);
+			}
+
+			int bits = _mm_movemask_ps(_mm_castsi128_ps(mask));
+			if (!bits)
+			{
+				continue;
+			}
+			covered += (bits & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + (bits >> 3);
+
+			const glm_vec4 dx = glm_vec4_add(_mm_set1_ps(float(x)), dxLane);
+			const size_t pixel = size_t(y) * stride + x;
+			glm_vec4 z = glm_vec4_fma(_mm_set1_ps(t.plane[0][1]), dx, rows[0]);
+			glm_vec4 depth = _mm_loadu_ps(&depths[pixel]);
+			glm_vec4 pass = _mm_and_ps(_mm_castsi128_ps(mask), _mm_cmplt_ps(z, depth));
+			if (!_mm_movemask_ps(pass))
+			{
+				continue;
+			}
+			_mm_storeu_ps(&depths[pixel], _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, depth)));
+
+			// perspective correct color: (c / w) / (1 / w)
+			glm_vec4 w = _mm_div_ps(one, glm_vec4_fma(_mm_set1_ps(t.plane[1][1]), dx, rows[1]));
+			__m128i rgba = _mm_set1_epi32(int(0xFF000000u));
+			for (int c = 0; c < 3; c++)
+			{
+				glm_vec4 value = glm_vec4_mul(glm_vec4_fma(_mm_set1_ps(t.plane[2 + c][1]), dx, rows[2 + c]), w);
+				value = glm_vec4_mul(_mm_min_ps(_mm_max_ps(value, zero), one), unorm);
+				rgba = _mm_or_si128(rgba, _mm_slli_epi32(_mm_cvtps_epi32(value), 8 * c));
+			}
+			__m128i* target = reinterpret_cast<__m128i*>(&colors[pixel]);
+			__m128i write = _mm_castps_si128(pass);
+			_mm_storeu_si128(target, _mm_or_si128(_mm_and_si128(write, rgba), _mm_andnot_si128(write, _mm_loadu_si128(target))));
+		}
+	}
+#else
+	for (int y = y0; y <= y1; y++, e[0] += stepY[0], e[1] += stepY[1], e[2] += stepY[2])
+	{
+		const float dy = float(y) + 0.5f - t.y0;
+		for (int x = x0; x <= x1; x++)
+		{
+			int32_t inside = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				inside |= e[k] + stepX[k] * (x - gx0);
+			}
+			if (inside < 0)
+			{
+				continue;
+			}
+			covered++;
+
+			const float dx = float(x) + 0.5f - t.x0;
+			const size_t pixel = size_t(y) * stride + x;
+			float z = t.plane[0][0] + t.plane[0][1] * dx + t.plane[0][2] * dy;
+			if (!(z < depths[pixel]))
+			{
+				continue;
+			}
+			depths[pixel] = z;
+
+			float w = 1.0f / (t.plane[1][0] + t.plane[1][1] * dx + t.plane[1][2] * dy);
+			glm::vec3 color;
+			for (int c = 0; c < 3; c++)
+			{
+				color[c] = (t.plane[2 + c][0] + t.plane[2 + c][1] * dx + t.plane[2 + c][2] * dy) * w;
+			}
+			colors[pixel] = rgba8(color);
+		}
+	}
+#endif
+
+	return covered;
+}
+
+bool SoftwareRasterizer::writePPM(const std::string& filename) const
+{
+	std::ofstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+	file << "P6\n" << width << " " << height << "\n255\n";
+
+	std::vector<char> row(size_t(width) * 3);
+	for (int y = height - 1; y >= 0; y--)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			uint32_t c = colors[size_t(y) * stride + x];
+			row[3 * x]     = char(c & 0xFF);
+			row[3 * x + 1] = char((c >> 8) & 0xFF);
+			row[3 * x + 2] = char((c >> 16) & 0xFF);
+		}
+		file.write(row.data(), row.size());
+	}
+	return bool(file);
+}
+
+const std::vector<uint32_t>& SoftwareRasterizer::getColors(void) const
+{
+	return colors;
+}
+
+const std::vector<float>& SoftwareRasterizer::getDepths(void) const
+{
+	return depths;
+}
+
+int SoftwareRasterizer::getWidth(void) const
+{
+	return width;
+}
+
+int SoftwareRasterizer::getHeight(void) const
+{
+	return height;
+}
+
+int SoftwareRasterizer::getStride(void) const
+{
+	return stride;
+}
+
+const SoftwareRasterizer::Statistics& SoftwareRasterizer::getStatistics(void) const
+{
+	return statistics;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#ifndef SOFTWARERASTERIZER_H
+#define SOFTWARERASTERIZER_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+namespace cg
+{
+	/*
+	 CPU rasterizer for machines without a GPU. Takes the mesh data of a Sphere draw (positions,
+	 colors, 16 or 32 bit indices, model-view-projection matrix) and renders like
+	 simple.vert/simple.frag: perspective correct vertex colors, GL_LESS depth test, no face
+	 culling, GL window coordinates (row 0 at the bottom).
+	 draw:   vertices to clip space, triangles clipped (near, far and a guard band), snapped to
+	         1/16 pixel and binned into TILE_SIZE^2 pixel tiles. Draws of many triangles are
+	         set up by several threads, every thread bins into its own batch.
+	 finish: all tiles rasterized in parallel. Coverage uses integer edge functions with the
+	         top-left rule, with SSE2 (GLM_ARCH_SSE2_BIT) four pixels per instruction.
+	 Every tile processes the batches in submission order, so the image does not depend on
+	 the number of threads.
+
+	 PROTOCOL
+	 this->clear
+	 this->draw      // any number of meshes
+	 this->finish    // rasterizes the draws since the last finish
+	 this->writePPM, this->getColors, this->getDepths
+	*/
+	class SoftwareRasterizer
+	{
+	public:
+		static const int TILE_SIZE = 64;
+
+		struct Statistics
+		{
+			size_t triangles;  // submitted
+			size_t rasterized; // after clipping, without degenerate and off-screen ones
+			size_t fragments;  // covered pixels, before the depth test
+		};
+
+		SoftwareRasterizer(int width, int height, unsigned threads = 0); // 0 threads: all hardware threads
+
+		void resize(int width, int height);
+		void setThreads(unsigned threads);
+
+		void clear(const glm::vec3& color, float depth = 1.0f); // takes effect in the next finish
+		void draw(const glm::mat4& mvp, const glm::vec3* positions, const glm::vec3* colors, size_t vertexCount,
+			const uint32_t* indices, size_t indexCount);
+		void draw(const glm::mat4& mvp, const glm::vec3* positions, const glm::vec3* colors, size_t vertexCount,
+			const uint16_t* indices, size_t indexCount);
+		void finish(void);
+
+		bool writePPM(const std::string& filename) const; // binary P6, top row first
+
+		const std::vector<uint32_t>& getColors(void) const; // RGBA8 like glReadPixels, row stride getStride()
+		const std::vector<float>&    getDepths(void) const;
+		int getWidth(void) const;
+		int getHeight(void) const;
+		int getStride(void) const;                   // pixels per row, a multiple of 4
+		const Statistics& getStatistics(void) const; // since the last clear
+
+	private:
+		// setup of a clipped triangle, counter-clockwise in window coordinates
+		struct Triangle
+		{
+			int minX, minY, maxX, maxY; // covered pixels, inside the viewport
+			int32_t a[3], b[3];         // edge functions a x + b y + c, 1/16 pixel units
+			int64_t c[3];
+			float x0, y0;               // origin of the planes
+			float plane[5][3];          // value at the origin, d/dx, d/dy of z, 1/w, r/w, g/w, b/w
+		};
+
+		// triangles of one thread and one draw, indices by tile
+		struct Batch
+		{
+			std::vector<Triangle> triangles;
+			std::vector<uint32_t> first; // tile t: ids[first[t]] .. ids[first[t + 1] - 1]
+			std::vector<uint32_t> ids;
+		};
+
+		// window coordinates, snapped
+		struct Window
+		{
+			int64_t   x, y;  // 1/16 pixel
+			float     z, w;  // depth, 1/w
+			glm::vec3 color; // divided by w
+		};
+
+		struct Vertex
+		{
+			glm::vec4 position; // clip space
+			glm::vec3 color;
+			int       outside;  // bit p: outside of planes[p]
+			Window    window;   // if inside the near, far and guard band planes
+		};
+
+		template <typename Index>
+		void drawIndexed(const glm::mat4& mvp, const glm::vec3* positions, const glm::vec3* colors, size_t vertexCount,
+			const Index* indices, size_t indexCount);
+
+		Window project(const glm::vec4& position, const glm::vec3& color) const;
+		void setup(const Vertex& a, const Vertex& b, const Vertex& c, std::vector<Triangle>& triangles) const; // clips, 0 or more triangles
+		void setup(const Window* a, const Window* b, const Window* c, std::vector<Triangle>& triangles) const;
+		void bin(Batch& batch) const;
+		size_t rasterize(const Triangle& triangle, int x0, int y0, int x1, int y1); // inclusive pixel rectangle, returns covered pixels
+
+		int width, height, stride;
+		int tilesX, tilesY;
+		unsigned threads;
+		glm::vec4 planes[10]; // clip space: near, far, guard band, viewport; inside if dot(plane, position) >= 0
+
+		std::vector<uint32_t> colors;
+		std::vector<float>    depths;
+		bool      clearPending;
+		uint32_t  clearColor;
+		float     clearDepth;
+
+		std::vector<Vertex> vertices; // of the current draw
+		std::vector<Batch>  batches;  // reused, the first batchCount belong to the current frame
+		size_t batchCount;
+		Statistics statistics;
+	};
+};
+
+#endif
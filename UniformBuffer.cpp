@@ -0,0 +1,64 @@
+#include "UniformBuffer.h"
+
+#include <cstring>
+
+#include "GLState.h"
+
+using namespace cg;
+
+UniformBuffer::UniformBuffer(void)
+: handle(0)
+, uploads(0)
+{
+}
+
+UniformBuffer::~UniformBuffer(void)
+{
+	GLState::deleteBuffers(1, &handle);
+	handle = 0;
+}
+
+void UniformBuffer::update(const void* data, GLsizeiptr size)
+{
+	if (handle > 0 && contents.size() == size_t(size) && std::memcmp(contents.data(), data, size) == 0)
+	{
+		return;
+	}
+
+	if (handle < 1)
+	{
+		glGenBuffers(1, &handle);
+	}
+
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, handle);
+
+	if (contents.size() != size_t(size))
+	{
+		glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+	}
+	else
+	{
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+	}
+
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	contents.assign(bytes, bytes + size);
+	uploads++;
+}
+
+void UniformBuffer::bind(GLuint binding) const
+{
+	GLState::bindBufferBase(GL_UNIFORM_BUFFER, binding, handle);
+}
+
+GLuint UniformBuffer::getHandle(void) const
+{
+	return handle;
+}
+
+unsigned long UniformBuffer::getUploads(void) const
+{
+	return uploads;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#ifndef UNIFORMBUFFER_H
+#define UNIFORMBUFFER_H
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include <GL/glew.h>
+
+namespace cg
+{
+	/*
+	 Per-frame constants shared by all programs, std140 layout of the block in shader/frame.glsl.
+	*/
+	struct FrameConstants
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::mat4 viewProjection; // projection * view
+
+		static const GLuint BINDING = 0; // uniform buffer binding point of the block
+	};
+
+	/*
+	 Uniform buffer object (GL_UNIFORM_BUFFER), contents must match the std140 layout of the block.
+	 PROTOCOL
+	 this->update              // (re)allocates if needed, skips unchanged contents
+	 this->bind(binding)       // glBindBufferBase, once: the binding stays until something else is bound
+	 GLSLProgram::bindUniformBlock(name, binding) // once per program after linking
+	*/
+	class UniformBuffer
+	{
+	public:
+		UniformBuffer(void);
+		~UniformBuffer(void); // GL context must exist on destruction
+
+		void update(const void* data, GLsizeiptr size);
+
+		template<typename T>
+		void update(const T& data)
+		{
+			update(&data, sizeof(T));
+		}
+
+		void bind(GLuint binding) const;
+
+		GLuint getHandle(void) const;
+		unsigned long getUploads(void) const; // glBufferSubData/glBufferData calls
+
+	private:
+		GLuint handle;
+		std::vector<uint8_t> contents; // last upload
+		unsigned long uploads;
+	};
+};
+
+#endif
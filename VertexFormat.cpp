@@ -0,0 +1,70 @@
+#include "VertexFormat.h"
+
+using namespace cg;
+
+VertexFormat::VertexFormat(void)
+: stride(0)
+{
+}
+
+GLsizei VertexFormat::typeSize(GLenum type)
+{
+	switch (type)
+	{
+	case GL_BYTE:
+	case GL_UNSIGNED_BYTE:
+		return 1;
+	case GL_SHORT:
+	case GL_UNSIGNED_SHORT:
+	case GL_HALF_FLOAT:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
+VertexFormat& VertexFormat::add(const std::string& name, GLint size, GLenum type, GLboolean normalized)
+{
+	Attribute attribute;
+	attribute.name       = name;
+	attribute.size       = size;
+	attribute.type       = type;
+	attribute.normalized = normalized;
+	attribute.bytes      = size * typeSize(type);
+	attribute.offset     = stride;
+
+	attributes.push_back(attribute);
+	stride += attribute.bytes;
+
+	return *this;
+}
+
+GLsizei VertexFormat::getStride(void) const
+{
+	return stride;
+}
+
+const std::vector<VertexFormat::Attribute>& VertexFormat::getAttributes(void) const
+{
+	return attributes;
+}
+
+void VertexFormat::setup(const GLSLProgram& program, GLintptr baseOffset, GLuint divisor) const
+{
+	GLuint programId = program.getHandle();
+
+	for (const Attribute& attribute : attributes)
+	{
+		GLint pos = glGetAttribLocation(programId, attribute.name.c_str());
+
+		if (pos < 0)
+		{
+			continue;
+		}
+
+		glEnableVertexAttribArray(pos);
+		glVertexAttribPointer(pos, attribute.size, attribute.type, attribute.normalized, stride,
+			reinterpret_cast<const void*>(baseOffset + attribute.offset));
+		glVertexAttribDivisor(pos, divisor);
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#ifndef VERTEXFORMAT_H
+#define VERTEXFORMAT_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+
+#include <glm/glm.hpp>
+
+#include <GL/glew.h>
+
+#include "GLSLProgram.h"
+
+namespace cg
+{
+	/*
+	 GL type, component count and normalization of a C++ vertex attribute type.
+	*/
+	template<typename T> struct VertexAttribType;
+	template<> struct VertexAttribType<float>       { enum { size = 1 }; static const GLenum type = GL_FLOAT;         static const GLboolean normalized = GL_FALSE; };
+	template<> struct VertexAttribType<glm::vec2>   { enum { size = 2 }; static const GLenum type = GL_FLOAT;         static const GLboolean normalized = GL_FALSE; };
+	template<> struct VertexAttribType<glm::vec3>   { enum { size = 3 }; static const GLenum type = GL_FLOAT;         static const GLboolean normalized = GL_FALSE; };
+	template<> struct VertexAttribType<glm::vec4>   { enum { size = 4 }; static const GLenum type = GL_FLOAT;         static const GLboolean normalized = GL_FALSE; };
+	template<> struct VertexAttribType<glm::u8vec4> { enum { size = 4 }; static const GLenum type = GL_UNSIGNED_BYTE; static const GLboolean normalized = GL_TRUE;  };
+	template<> struct VertexAttribType<glm::u16vec4>{ enum { size = 4 }; static const GLenum type = GL_UNSIGNED_SHORT;static const GLboolean normalized = GL_TRUE;  };
+	template<> struct VertexAttribType<glm::i16vec2>{ enum { size = 2 }; static const GLenum type = GL_SHORT;         static const GLboolean normalized = GL_TRUE;  };
+
+	/*
+	 Layout of one interleaved vertex buffer: attributes are packed in the order they are added,
+	 offsets and stride follow from their sizes.
+	 PROTOCOL
+	 this->add                 // for every attribute, name as in the vertex shader
+	 this->interleave          // one array per attribute (same order) -> one buffer
+	 glBindVertexArray, glBindBuffer(GL_ARRAY_BUFFER, ..), glBufferData
+	 this->setup               // glVertexAttribPointer for all attributes the program uses
+	*/
+	class VertexFormat
+	{
+	public:
+		struct Attribute
+		{
+			std::string name;
+			GLint       size;       // number of components
+			GLenum      type;       // GL_FLOAT, GL_UNSIGNED_BYTE, ..
+			GLboolean   normalized;
+			GLsizei     bytes;      // size of the attribute in bytes
+			GLsizei     offset;     // offset in the vertex in bytes
+		};
+
+		VertexFormat(void);
+
+		VertexFormat& add(const std::string& name, GLint size, GLenum type = GL_FLOAT, GLboolean normalized = GL_FALSE);
+
+		template<typename T>
+		VertexFormat& add(const std::string& name)
+		{
+			return add(name, VertexAttribType<T>::size, VertexAttribType<T>::type, VertexAttribType<T>::normalized);
+		}
+
+		GLsizei getStride(void) const;
+		const std::vector<Attribute>& getAttributes(void) const;
+
+		// Packs one array per attribute into one interleaved array.
+		template<typename... T>
+		std::vector<uint8_t> interleave(const std::vector<T>&... streams) const
+		{
+			assert(sizeof...(T) == attributes.size());
+
+			const size_t sizes[]  = { streams.size()... };
+			const void*  arrays[] = { static_cast<const void*>(streams.data())... };
+			const size_t bytes[]  = { sizeof(T)... };
+
+			std::vector<uint8_t> data(sizes[0] * stride);
+			for (size_t a = 0; a < attributes.size(); a++)
+			{
+				assert(sizes[a] == sizes[0] && bytes[a] == size_t(attributes[a].bytes));
+
+				const uint8_t* src = static_cast<const uint8_t*>(arrays[a]);
+				uint8_t* dst = data.data() + attributes[a].offset;
+				for (size_t v = 0; v < sizes[0]; v++, src += bytes[a], dst += stride)
+				{
+					std::memcpy(dst, src, bytes[a]);
+				}
+			}
+			return data;
+		}
+
+		// Enables and points all attributes found in the program, a VAO and the
+		// interleaved GL_ARRAY_BUFFER must be bound. Attributes the program does not use are skipped.
+		// divisor 1: per-instance attributes (advance once per instance).
+		void setup(const GLSLProgram& program, GLintptr baseOffset = 0, GLuint divisor = 0) const;
+
+		static GLsizei typeSize(GLenum type);
+
+	private:
+		std::vector<Attribute> attributes;
+		GLsizei stride;
+	};
+};
+
+#endif
@@ -0,0 +1,235 @@
+#include "VertexPacking.h"
+
+#include <cmath>
+#include <cstring>
+
+#include <glm/simd/common.h>
+
+using namespace cg;
+
+namespace
+{
+	// float to half: round to nearest even, denormals flush to 0, overflow and NaN to infinity
+	uint16_t half(float value)
+	{
+		uint32_t x;
+		std::memcpy(&x, &value, sizeof(x));
+		uint32_t sign = (x >> 16) & 0x8000;
+		uint32_t a = x & 0x7FFFFFFF;
+
+		if (a < 0x38800000) // 2^-14
+		{
+			return uint16_t(sign);
+		}
+		if (a >= 0x477FF000) // 65520 rounds to infinity
+		{
+			return uint16_t(sign | 0x7C00);
+		}
+		return uint16_t(sign | ((a - 0x38000000 + 0x0FFF + ((a >> 13) & 1)) >> 13));
+	}
+
+	// rounding like _mm_cvtps_epi32 (to nearest even)
+	int roundEven(float value)
+	{
+		return int(std::nearbyint(value));
+	}
+
+	float signNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+	__m128i halfs(__m128 value)
+	{
+		__m128i x = _mm_castps_si128(value);
+		__m128i a = _mm_and_si128(x, _mm_set1_epi32(0x7FFFFFFF));
+		__m128i odd = _mm_and_si128(_mm_srli_epi32(a, 13), _mm_set1_epi32(1));
+		__m128i h = _mm_srli_epi32(_mm_add_epi32(_mm_sub_epi32(a, _mm_set1_epi32(0x38000000 - 0x0FFF)), odd), 13);
+
+		__m128i small = _mm_cmplt_epi32(a, _mm_set1_epi32(0x38800000));
+		__m128i large = _mm_cmpgt_epi32(a, _mm_set1_epi32(0x477FEFFF));
+		h = _mm_andnot_si128(small, h);
+		h = _mm_or_si128(_mm_andnot_si128(large, h), _mm_and_si128(large, _mm_set1_epi32(0x7C00)));
+		return h; // without sign, see packHalfs
+	}
+
+	// 8 halfs of two float4
+	__m128i packHalfs(__m128 a, __m128 b)
+	{
+		__m128i magnitude = _mm_packs_epi32(halfs(a), halfs(b)); // <= 0x7C00, no saturation
+		__m128i sign = _mm_packs_epi32(_mm_srai_epi32(_mm_castps_si128(a), 16), _mm_srai_epi32(_mm_castps_si128(b), 16));
+		return _mm_or_si128(magnitude, _mm_and_si128(sign, _mm_set1_epi16(short(0x8000))));
+	}
+#endif
+}
+
+VertexPacking::Bounds VertexPacking::bounds(const glm::vec3* positions, size_t count)
+{
+	Bounds bounds = { glm::vec3(0.0f), glm::vec3(0.0f) };
+	if (count > 0)
+	{
+		bounds.min = bounds.max = positions[0];
+	}
+	for (size_t i = 1; i < count; i++)
+	{
+		bounds.min = glm::min(bounds.min, positions[i]);
+		bounds.max = glm::max(bounds.max, positions[i]);
+	}
+	return bounds;
+}
+
+void VertexPacking::packPositions(const glm::vec3* positions, size_t count, const Bounds& bounds, glm::u16vec4* out)
+{
+	const glm::vec3 extent = bounds.max - bounds.min;
+	const glm::vec3 scale(extent.x > 0.0f ? 65535.0f / extent.x : 0.0f,
+	                      extent.y > 0.0f ? 65535.0f / extent.y : 0.0f,
+	                      extent.z > 0.0f ? 65535.0f / extent.z : 0.0f);
+	size_t i = 0;
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+	// two vertices per iteration, the 4th float of a load is the next vertex: stop 2 early
+	const __m128 min    = _mm_setr_ps(bounds.min.x, bounds.min.y, bounds.min.z, 0.0f);
+	const __m128 factor = _mm_setr_ps(scale.x, scale.y, scale.z, 0.0f); // w = 0
+	const __m128 zero   = _mm_setzero_ps();
+	const __m128 one    = _mm_set1_ps(65535.0f);
+	const __m128i bias  = _mm_set1_epi32(32768);
+
+	for (; i + 2 < count; i += 2)
+	{
+		__m128 a = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&positions[i].x), min), factor);
+		__m128 b = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&positions[i + 1].x), min), factor);
+		a = _mm_min_ps(_mm_max_ps(a, zero), one);
+		b = _mm_min_ps(_mm_max_ps(b, zero), one);
+
+		// unsigned 16 bit through the signed pack: shift by 32768 and back
+		__m128i packed = _mm_packs_epi32(_mm_sub_epi32(_mm_cvtps_epi32(a), bias), _mm_sub_epi32(_mm_cvtps_epi32(b), bias));
+		packed = _mm_xor_si128(packed, _mm_set1_epi16(short(0x8000)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&out[i]), packed);
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		glm::vec3 v = glm::clamp((positions[i] - bounds.min) * scale, 0.0f, 65535.0f);
+		out[i] = glm::u16vec4(roundEven(v.x), roundEven(v.y), roundEven(v.z), 0);
+	}
+}
+
+void VertexPacking::packPositionsHalf(const glm::vec3* positions, size_t count, glm::u16vec4* out)
+{
+	size_t i = 0;
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+	const __m128 xyz = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+	const __m128 w   = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+	for (; i + 2 < count; i += 2)
+	{
+		__m128 a = _mm_or_ps(_mm_and_ps(_mm_loadu_ps(&positions[i].x), xyz), w);
+		__m128 b = _mm_or_ps(_mm_and_ps(_mm_loadu_ps(&positions[i + 1].x), xyz), w);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&out[i]), packHalfs(a, b));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		out[i] = glm::u16vec4(half(positions[i].x), half(positions[i].y), half(positions[i].z), half(1.0f));
+	}
+}
+
+glm::vec2 VertexPacking::octahedral(const glm::vec3& n)
+{
+	// project onto the octahedron |x| + |y| + |z| = 1, fold the lower half over the upper one
+	glm::vec2 p = glm::vec2(n) / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+	if (n.z < 0.0f)
+	{
+		p = glm::vec2((1.0f - std::abs(p.y)) * signNotZero(p.x), (1.0f - std::abs(p.x)) * signNotZero(p.y));
+	}
+	return p;
+}
+
+glm::vec3 VertexPacking::octahedralDecode(const glm::vec2& e)
+{
+	glm::vec3 n(e, 1.0f - std::abs(e.x) - std::abs(e.y));
+	float t = glm::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return glm::normalize(n);
+}
+
+void VertexPacking::packNormals(const glm::vec3* normals, size_t count, glm::i16vec2* out)
+{
+	size_t i = 0;
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+	// four normals per iteration, one component per register
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(int(0x80000000)));
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 snorm = _mm_set1_ps(32767.0f);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const glm::vec3* n = normals + i;
+		__m128 x = _mm_setr_ps(n[0].x, n[1].x, n[2].x, n[3].x);
+		__m128 y = _mm_setr_ps(n[0].y, n[1].y, n[2].y, n[3].y);
+		__m128 z = _mm_setr_ps(n[0].z, n[1].z, n[2].z, n[3].z);
+
+		__m128 l1 = _mm_add_ps(_mm_add_ps(_mm_and_ps(x, absMask), _mm_and_ps(y, absMask)), _mm_and_ps(z, absMask));
+		__m128 px = _mm_div_ps(x, l1);
+		__m128 py = _mm_div_ps(y, l1);
+
+		// lower half: (1 - |p.yx|) * signNotZero(p.xy); -0.0 counts as positive like in octahedral()
+		__m128 sx = _mm_or_ps(one, _mm_and_ps(_mm_cmplt_ps(px, _mm_setzero_ps()), signMask));
+		__m128 sy = _mm_or_ps(one, _mm_and_ps(_mm_cmplt_ps(py, _mm_setzero_ps()), signMask));
+		__m128 fx = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(py, absMask)), sx);
+		__m128 fy = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(px, absMask)), sy);
+		__m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+		px = _mm_or_ps(_mm_and_ps(lower, fx), _mm_andnot_ps(lower, px));
+		py = _mm_or_ps(_mm_and_ps(lower, fy), _mm_andnot_ps(lower, py));
+
+		__m128i ix = _mm_cvtps_epi32(_mm_mul_ps(px, snorm));
+		__m128i iy = _mm_cvtps_epi32(_mm_mul_ps(py, snorm));
+		__m128i packed = _mm_packs_epi32(_mm_unpacklo_epi32(ix, iy), _mm_unpackhi_epi32(ix, iy)); // x0 y0 x1 y1 ..
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&out[i]), packed);
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		glm::vec2 e = glm::clamp(octahedral(normals[i]), -1.0f, 1.0f) * 32767.0f;
+		out[i] = glm::i16vec2(roundEven(e.x), roundEven(e.y));
+	}
+}
+
+void VertexPacking::packColors(const glm::vec3* colors, size_t count, glm::u8vec4* out)
+{
+	size_t i = 0;
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+	// four colors per iteration, the 4th float of a load is the next color: stop 1 early
+	const __m128 rgb   = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+	const __m128 alpha = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+	const __m128 unorm = _mm_set1_ps(255.0f);
+
+	for (; i + 4 < count; i += 4)
+	{
+		__m128i c[4];
+		for (int k = 0; k < 4; k++)
+		{
+			__m128 v = _mm_or_ps(_mm_and_ps(_mm_loadu_ps(&colors[i + k].r), rgb), alpha);
+			c[k] = _mm_cvtps_epi32(_mm_mul_ps(v, unorm));
+		}
+		// saturating packs clamp to [0, 255]
+		__m128i packed = _mm_packus_epi16(_mm_packs_epi32(c[0], c[1]), _mm_packs_epi32(c[2], c[3]));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&out[i]), packed);
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		glm::vec3 v = glm::clamp(colors[i], 0.0f, 1.0f) * 255.0f;
+		out[i] = glm::u8vec4(roundEven(v.r), roundEven(v.g), roundEven(v.b), 255);
+	}
+}
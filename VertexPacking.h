@@ -0,0 +1,45 @@
+#pragma once
+
+#ifndef VERTEXPACKING_H
+#define VERTEXPACKING_H
+
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+namespace cg
+{
+	/*
+	 Batch conversion of float vertex attributes to compact GL formats, the encodings of
+	 glm/gtc/packing.hpp; with SSE2 (GLM_ARCH_SSE2_BIT) several components per instruction.
+	  positions  unorm16x4 relative to the mesh bounds (GL_UNSIGNED_SHORT, normalized) or
+	             half x4 (GL_HALF_FLOAT, denormals flushed to 0): 8 instead of 12 bytes
+	  normals    octahedral snorm16x2 (GL_SHORT, normalized): 4 instead of 12 bytes
+	  colors     unorm8x4, alpha 1 (GL_UNSIGNED_BYTE, normalized): 4 instead of 12 bytes
+	 shader/packing.glsl decodes them: position * positionScale + positionOffset with
+	 Bounds::scale and Bounds::offset (1 and 0 for half positions), octahedralDecode(normal).
+	*/
+	class VertexPacking
+	{
+	public:
+		struct Bounds
+		{
+			glm::vec3 min, max;
+
+			glm::vec3 scale(void) const  { return max - min; } // decode: unorm * scale + offset
+			glm::vec3 offset(void) const { return min; }
+		};
+
+		static Bounds bounds(const glm::vec3* positions, size_t count);
+
+		static void packPositions(const glm::vec3* positions, size_t count, const Bounds& bounds, glm::u16vec4* out); // unorm16, w = 0
+		static void packPositionsHalf(const glm::vec3* positions, size_t count, glm::u16vec4* out);                   // w = 1
+		static void packNormals(const glm::vec3* normals, size_t count, glm::i16vec2* out);                          // unit length
+		static void packColors(const glm::vec3* colors, size_t count, glm::u8vec4* out);
+
+		static glm::vec2 octahedral(const glm::vec3& normal);  // [-1, 1]^2
+		static glm::vec3 octahedralDecode(const glm::vec2& e); // as in the shader
+	};
+};
+
+#endif
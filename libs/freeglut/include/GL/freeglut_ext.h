@@ -90,6 +90,8 @@
 
 #define  GLUT_STROKE_FONT_DRAW_JOIN_DOTS    0x0206  /* Draw dots between line segments of stroke fonts? */
 
+#define  GLUT_GEOMETRY_CACHE_SIZE           0x0207  /* Max. number of shapes whose buffer objects are kept, 0 disables the cache */
+
 /*
  * New tokens for glutInitDisplayMode.
  * Only one GLUT_AUXn bit may be used at a time.
@@ -180,6 +182,7 @@ FGAPI void    FGAPIENTRY glutWireSierpinskiSponge ( int num_levels, double offse
 FGAPI void    FGAPIENTRY glutSolidSierpinskiSponge ( int num_levels, double offset[3], double scale );
 FGAPI void    FGAPIENTRY glutWireCylinder( double radius, double height, GLint slices, GLint stacks);
 FGAPI void    FGAPIENTRY glutSolidCylinder( double radius, double height, GLint slices, GLint stacks);
+FGAPI void    FGAPIENTRY glutFlushGeometryCache( void );
 
 /*
  * Rest of functions for rendering Newell's teaset, found in fg_teapot.c
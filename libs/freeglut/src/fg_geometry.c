@@ -58,6 +58,11 @@ static void fghDrawGeometryWire20(GLfloat *vertices, GLfloat *normals, GLsizei n
 static void fghDrawGeometrySolid20(GLfloat *vertices, GLfloat *normals, GLfloat *textcs, GLsizei numVertices,
                                    GLushort *vertIdxs, GLsizei numParts, GLsizei numVertIdxsPerPart,
                                    GLint attribute_v_coord, GLint attribute_v_normal, GLint attribute_v_texture);
+typedef struct tagSFG_GeometryBuffers SFG_GeometryBuffers;
+static void fghDrawGeometryBuffersWire20(const SFG_GeometryBuffers *buffers,
+                                         GLint attribute_v_coord, GLint attribute_v_normal);
+static void fghDrawGeometryBuffersSolid20(const SFG_GeometryBuffers *buffers,
+                                          GLint attribute_v_coord, GLint attribute_v_normal, GLint attribute_v_texture);
 /* declare function for generating visualization of normals */
 static void fghGenerateNormalVisualization(GLfloat *vertices, GLfloat *normals, GLsizei numVertices);
 static void fghDrawNormalVisualization11();
@@ -274,51 +279,232 @@ static void fghDrawGeometrySolid11(GLfloat *vertices, GLfloat *normals, GLfloat
         glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 }
 
-/* Version for OpenGL (ES) >= 2.0 */
-static void fghDrawGeometryWire20(GLfloat *vertices, GLfloat *normals, GLsizei numVertices,
-                                  GLushort *vertIdxs, GLsizei numParts, GLsizei numVertPerPart, GLenum vertexMode,
-                                  GLushort *vertIdxs2, GLsizei numParts2, GLsizei numVertPerPart2,
-                                  GLint attribute_v_coord, GLint attribute_v_normal)
+/* -- GEOMETRY CACHE ---------------------------------------------------- */
+/*
+ * The non-polyhedra (sphere, cone, cylinder and torus) are costly to
+ * generate and upload. With the OpenGL (ES) >= 2.0 draw path their buffer
+ * objects are therefore kept per window, keyed by shape type and parameters,
+ * and reused by later calls with the same parameters: a cache hit neither
+ * generates the geometry nor uploads it again.
+ * At most fgState.GeometryCacheSize (GLUT_GEOMETRY_CACHE_SIZE) shapes are
+ * kept, the least recently drawn one of the current window is evicted first.
+ * Entries of other windows are never evicted (their buffer objects belong to
+ * another context), so with several windows the cache can exceed its size.
+ * glutFlushGeometryCache() frees all entries of the current window.
+ * Not cached: the 1.1 path (client side arrays) and drawing with
+ * GLUT_GEOMETRY_VISUALIZE_NORMALS, which needs the generated vertices.
+ */
+typedef enum
 {
-    GLuint vbo_coords = 0, vbo_normals = 0,
-        ibo_elements = 0, ibo_elements2 = 0;
-    GLsizei numVertIdxs = numParts * numVertPerPart;
-    GLsizei numVertIdxs2 = numParts2 * numVertPerPart2;
-    int i;
+    FGH_SHAPE_SPHERE,
+    FGH_SHAPE_CONE,
+    FGH_SHAPE_CYLINDER,
+    FGH_SHAPE_TORUS
+} fghShape;
+
+typedef struct tagSFG_GeometryKey SFG_GeometryKey;
+struct tagSFG_GeometryKey
+{
+    int         WindowID;               /* buffer objects belong to this window's context */
+    fghShape    Shape;
+    GLboolean   Wire;
+    GLfloat     Size[2];                /* radius/base/inner radius, height/outer radius */
+    GLint       Subdivisions[2];        /* slices/sides, stacks/rings */
+};
 
-    if (numVertices > 0 && attribute_v_coord != -1) {
-        fghGenBuffers(1, &vbo_coords);
-        fghBindBuffer(FGH_ARRAY_BUFFER, vbo_coords);
-        fghBufferData(FGH_ARRAY_BUFFER, numVertices * 3 * sizeof(vertices[0]),
-                      vertices, FGH_STATIC_DRAW);
-    }
-    
-    if (numVertices > 0 && attribute_v_normal != -1) {
-        fghGenBuffers(1, &vbo_normals);
-        fghBindBuffer(FGH_ARRAY_BUFFER, vbo_normals);
-        fghBufferData(FGH_ARRAY_BUFFER, numVertices * 3 * sizeof(normals[0]),
-                      normals, FGH_STATIC_DRAW);
+/* Buffer objects of one shape and what is needed to draw them again */
+struct tagSFG_GeometryBuffers
+{
+    GLuint      vbo_coords, vbo_normals, vbo_textcs;
+    GLuint      ibo_elements, ibo_elements2;
+    GLsizei     numVertices;
+    GLsizei     numParts, numVertPerPart;   /* see fghDrawGeometryWire/fghDrawGeometrySolid */
+    GLenum      vertexMode;                 /* wire only */
+    GLsizei     numParts2, numVertPerPart2; /* wire only */
+};
+
+typedef struct tagSFG_GeometryCacheEntry SFG_GeometryCacheEntry;
+struct tagSFG_GeometryCacheEntry
+{
+    SFG_GeometryKey     Key;
+    SFG_GeometryBuffers Buffers;
+    unsigned long       LastUsed;       /* for least recently used eviction */
+};
+
+static SFG_GeometryCacheEntry *fghGeometryCache = NULL;
+static int                     fghGeometryCacheCount = 0;
+static int                     fghGeometryCacheCapacity = 0;
+static unsigned long           fghGeometryCacheClock = 0;
+
+/* Key of the shape being drawn, set between fghBeginCachedGeometry and
+   fghEndCachedGeometry if its buffers are to be kept */
+static const SFG_GeometryKey  *fghGeometryCacheKey = NULL;
+
+static GLboolean fghGeometryCacheUsable( void )
+{
+    SFG_Window *window = fgStructure.CurrentWindow;
+
+    return fgState.GeometryCacheSize > 0 && window && fgState.HasOpenGL20 &&
+           (window->Window.attribute_v_coord != -1 || window->Window.attribute_v_normal != -1) &&
+           !window->State.VisualizeNormals;
+}
+
+static void fghInitGeometryKey( SFG_GeometryKey *key, fghShape shape, GLboolean wire,
+                                GLfloat size0, GLfloat size1, GLint subdivisions0, GLint subdivisions1 )
+{
+    /* zero the padding as well, keys are compared with memcmp */
+    memset(key, 0, sizeof(SFG_GeometryKey));
+    key->WindowID        = fgStructure.CurrentWindow ? fgStructure.CurrentWindow->ID : 0;
+    key->Shape           = shape;
+    key->Wire            = wire;
+    key->Size[0]         = size0;
+    key->Size[1]         = size1;
+    key->Subdivisions[0] = subdivisions0;
+    key->Subdivisions[1] = subdivisions1;
+}
+
+static void fghDeleteGeometryBuffers( SFG_GeometryBuffers *buffers )
+{
+    if (buffers->vbo_coords != 0)
+        fghDeleteBuffers(1, &buffers->vbo_coords);
+    if (buffers->vbo_normals != 0)
+        fghDeleteBuffers(1, &buffers->vbo_normals);
+    if (buffers->vbo_textcs != 0)
+        fghDeleteBuffers(1, &buffers->vbo_textcs);
+    if (buffers->ibo_elements != 0)
+        fghDeleteBuffers(1, &buffers->ibo_elements);
+    if (buffers->ibo_elements2 != 0)
+        fghDeleteBuffers(1, &buffers->ibo_elements2);
+}
+
+static void fghRemoveGeometryCacheEntry( int i, GLboolean deleteBuffers )
+{
+    if (deleteBuffers)
+        fghDeleteGeometryBuffers(&fghGeometryCache[i].Buffers);
+
+    /* order does not matter, move the last entry into the gap */
+    fghGeometryCache[i] = fghGeometryCache[--fghGeometryCacheCount];
+}
+
+static void fghStoreGeometry( const SFG_GeometryKey *key, const SFG_GeometryBuffers *buffers )
+{
+    SFG_GeometryCacheEntry *entry;
+
+    while (fghGeometryCacheCount >= fgState.GeometryCacheSize)
+    {
+        /* Evict the least recently used entry of the current window: only the
+           buffer objects of the current context can be deleted here. If the
+           other windows hold all entries, the cache grows over its size until
+           they store shapes themselves, are flushed or are destroyed. */
+        int i, lru = -1;
+        for (i=0; i<fghGeometryCacheCount; i++)
+            if (fghGeometryCache[i].Key.WindowID == key->WindowID &&
+                (lru == -1 || fghGeometryCache[i].LastUsed < fghGeometryCache[lru].LastUsed))
+                lru = i;
+
+        if (lru == -1)
+            break;
+        fghRemoveGeometryCacheEntry(lru, GL_TRUE);
     }
-    
-    if (vertIdxs != NULL) {
-        fghGenBuffers(1, &ibo_elements);
-        fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, ibo_elements);
-        fghBufferData(FGH_ELEMENT_ARRAY_BUFFER, numVertIdxs * sizeof(vertIdxs[0]),
-                      vertIdxs, FGH_STATIC_DRAW);
-        fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, 0);
+
+    if (fghGeometryCacheCount == fghGeometryCacheCapacity)
+    {
+        int capacity = fghGeometryCacheCapacity ? 2*fghGeometryCacheCapacity : 16;
+        SFG_GeometryCacheEntry *cache = realloc(fghGeometryCache, capacity * sizeof(SFG_GeometryCacheEntry));
+
+        /* Bail out if memory allocation fails, fgError never returns */
+        if (!cache)
+            fgError("Failed to allocate memory in fghStoreGeometry");
+
+        fghGeometryCache         = cache;
+        fghGeometryCacheCapacity = capacity;
     }
 
-    if (vertIdxs2 != NULL) {
-        fghGenBuffers(1, &ibo_elements2);
-        fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, ibo_elements2);
-        fghBufferData(FGH_ELEMENT_ARRAY_BUFFER, numVertIdxs2 * sizeof(vertIdxs2[0]),
-                      vertIdxs2, FGH_STATIC_DRAW);
-        fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, 0);
+    entry = &fghGeometryCache[fghGeometryCacheCount++];
+    entry->Key      = *key;
+    entry->Buffers  = *buffers;
+    entry->LastUsed = ++fghGeometryCacheClock;
+}
+
+static SFG_GeometryCacheEntry *fghFindGeometry( const SFG_GeometryKey *key )
+{
+    int i;
+
+    for (i=0; i<fghGeometryCacheCount; i++)
+        if (!memcmp(&fghGeometryCache[i].Key, key, sizeof(SFG_GeometryKey)))
+            return &fghGeometryCache[i];
+
+    return NULL;
+}
+
+/*
+ * Draws the shape from the cache, returns GL_FALSE if it is not cached
+ * (or the cache is not usable), in which case the caller has to generate it.
+ */
+static GLboolean fghDrawCachedGeometry( const SFG_GeometryKey *key )
+{
+    SFG_GeometryCacheEntry *entry;
+
+    if (!fghGeometryCacheUsable())
+        return GL_FALSE;
+
+    entry = fghFindGeometry(key);
+    if (!entry)
+        return GL_FALSE;
+
+    entry->LastUsed = ++fghGeometryCacheClock;
+
+    if (key->Wire)
+        fghDrawGeometryBuffersWire20(&entry->Buffers,
+                                     fgStructure.CurrentWindow->Window.attribute_v_coord,
+                                     fgStructure.CurrentWindow->Window.attribute_v_normal);
+    else
+        fghDrawGeometryBuffersSolid20(&entry->Buffers,
+                                      fgStructure.CurrentWindow->Window.attribute_v_coord,
+                                      fgStructure.CurrentWindow->Window.attribute_v_normal,
+                                      fgStructure.CurrentWindow->Window.attribute_v_texture);
+    return GL_TRUE;
+}
+
+/* The buffer objects created by the next fghDrawGeometryWire/Solid are kept under key */
+static void fghBeginCachedGeometry( const SFG_GeometryKey *key )
+{
+    fghGeometryCacheKey = fghGeometryCacheUsable() ? key : NULL;
+}
+
+static void fghEndCachedGeometry( void )
+{
+    fghGeometryCacheKey = NULL;
+}
+
+/* Called when a window is destroyed or freeglut is deinitialized, no GL calls */
+void fgDropGeometryCache( SFG_Window *window )
+{
+    int i;
+
+    if (!window)
+    {
+        free(fghGeometryCache);
+        fghGeometryCache         = NULL;
+        fghGeometryCacheCount    = 0;
+        fghGeometryCacheCapacity = 0;
+        return;
     }
 
-    if (vbo_coords) {
+    for (i=fghGeometryCacheCount-1; i>=0; i--)
+        if (fghGeometryCache[i].Key.WindowID == window->ID)
+            fghRemoveGeometryCacheEntry(i, GL_FALSE);
+}
+
+/* Version for OpenGL (ES) >= 2.0 */
+static void fghDrawGeometryBuffersWire20(const SFG_GeometryBuffers *buffers,
+                                         GLint attribute_v_coord, GLint attribute_v_normal)
+{
+    int i;
+
+    if (buffers->vbo_coords && attribute_v_coord != -1) {
         fghEnableVertexAttribArray(attribute_v_coord);
-        fghBindBuffer(FGH_ARRAY_BUFFER, vbo_coords);
+        fghBindBuffer(FGH_ARRAY_BUFFER, buffers->vbo_coords);
         fghVertexAttribPointer(
             attribute_v_coord,  /* attribute */
             3,                  /* number of elements per vertex, here (x,y,z) */
@@ -330,9 +516,9 @@ static void fghDrawGeometryWire20(GLfloat *vertices, GLfloat *normals, GLsizei n
         fghBindBuffer(FGH_ARRAY_BUFFER, 0);
     }
 
-    if (vbo_normals) {
+    if (buffers->vbo_normals && attribute_v_normal != -1) {
         fghEnableVertexAttribArray(attribute_v_normal);
-        fghBindBuffer(FGH_ARRAY_BUFFER, vbo_normals);
+        fghBindBuffer(FGH_ARRAY_BUFFER, buffers->vbo_normals);
         fghVertexAttribPointer(
             attribute_v_normal, /* attribute */
             3,                  /* number of elements per vertex, here (x,y,z) */
@@ -344,92 +530,104 @@ static void fghDrawGeometryWire20(GLfloat *vertices, GLfloat *normals, GLsizei n
         fghBindBuffer(FGH_ARRAY_BUFFER, 0);
     }
 
-    if (!vertIdxs) {
+    if (!buffers->ibo_elements) {
         /* Draw per face (TODO: could use glMultiDrawArrays if available) */
-        for (i=0; i<numParts; i++)
-            glDrawArrays(vertexMode, i*numVertPerPart, numVertPerPart);
+        for (i=0; i<buffers->numParts; i++)
+            glDrawArrays(buffers->vertexMode, i*buffers->numVertPerPart, buffers->numVertPerPart);
     } else {
-        fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, ibo_elements);
-        for (i=0; i<numParts; i++)
-            glDrawElements(vertexMode, numVertPerPart,
-                           GL_UNSIGNED_SHORT, (GLvoid*)(sizeof(vertIdxs[0])*i*numVertPerPart));
+        fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, buffers->ibo_elements);
+        for (i=0; i<buffers->numParts; i++)
+            glDrawElements(buffers->vertexMode, buffers->numVertPerPart,
+                           GL_UNSIGNED_SHORT, (GLvoid*)(sizeof(GLushort)*i*buffers->numVertPerPart));
         /* Clean existing bindings before clean-up */
         /* Android showed instability otherwise */
         fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, 0);
     }
 
-    if (vertIdxs2) {
-        fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, ibo_elements2);
-        for (i=0; i<numParts2; i++)
-            glDrawElements(GL_LINE_LOOP, numVertPerPart2,
-                           GL_UNSIGNED_SHORT, (GLvoid*)(sizeof(vertIdxs2[0])*i*numVertPerPart2));
+    if (buffers->ibo_elements2) {
+        fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, buffers->ibo_elements2);
+        for (i=0; i<buffers->numParts2; i++)
+            glDrawElements(GL_LINE_LOOP, buffers->numVertPerPart2,
+                           GL_UNSIGNED_SHORT, (GLvoid*)(sizeof(GLushort)*i*buffers->numVertPerPart2));
         /* Clean existing bindings before clean-up */
         /* Android showed instability otherwise */
         fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, 0);
     }
     
-    if (vbo_coords != 0)
+    if (buffers->vbo_coords && attribute_v_coord != -1)
         fghDisableVertexAttribArray(attribute_v_coord);
-    if (vbo_normals != 0)
+    if (buffers->vbo_normals && attribute_v_normal != -1)
         fghDisableVertexAttribArray(attribute_v_normal);
-    
-    if (vbo_coords != 0)
-        fghDeleteBuffers(1, &vbo_coords);
-    if (vbo_normals != 0)
-        fghDeleteBuffers(1, &vbo_normals);
-    if (ibo_elements != 0)
-        fghDeleteBuffers(1, &ibo_elements);
-    if (ibo_elements2 != 0)
-        fghDeleteBuffers(1, &ibo_elements2);
 }
 
-
-
-
-/* Version for OpenGL (ES) >= 2.0 */
-static void fghDrawGeometrySolid20(GLfloat *vertices, GLfloat *normals, GLfloat *textcs, GLsizei numVertices,
-                                   GLushort *vertIdxs, GLsizei numParts, GLsizei numVertIdxsPerPart,
-                                   GLint attribute_v_coord, GLint attribute_v_normal, GLint attribute_v_texture)
+static void fghDrawGeometryWire20(GLfloat *vertices, GLfloat *normals, GLsizei numVertices,
+                                  GLushort *vertIdxs, GLsizei numParts, GLsizei numVertPerPart, GLenum vertexMode,
+                                  GLushort *vertIdxs2, GLsizei numParts2, GLsizei numVertPerPart2,
+                                  GLint attribute_v_coord, GLint attribute_v_normal)
 {
-    GLuint vbo_coords = 0, vbo_normals = 0, vbo_textcs = 0, ibo_elements = 0;
-    GLsizei numVertIdxs = numParts * numVertIdxsPerPart;
-    int i;
-  
-    if (numVertices > 0 && attribute_v_coord != -1) {
-        fghGenBuffers(1, &vbo_coords);
-        fghBindBuffer(FGH_ARRAY_BUFFER, vbo_coords);
+    SFG_GeometryBuffers buffers;
+    GLsizei numVertIdxs = numParts * numVertPerPart;
+    GLsizei numVertIdxs2 = numParts2 * numVertPerPart2;
+
+    memset(&buffers, 0, sizeof(buffers));
+    buffers.numVertices     = numVertices;
+    buffers.numParts        = numParts;
+    buffers.numVertPerPart  = numVertPerPart;
+    buffers.vertexMode      = vertexMode;
+    buffers.numParts2       = numParts2;
+    buffers.numVertPerPart2 = numVertPerPart2;
+
+    /* buffers kept in the cache have all attributes, later draws may use them */
+    if (numVertices > 0 && (attribute_v_coord != -1 || fghGeometryCacheKey)) {
+        fghGenBuffers(1, &buffers.vbo_coords);
+        fghBindBuffer(FGH_ARRAY_BUFFER, buffers.vbo_coords);
         fghBufferData(FGH_ARRAY_BUFFER, numVertices * 3 * sizeof(vertices[0]),
                       vertices, FGH_STATIC_DRAW);
-        fghBindBuffer(FGH_ARRAY_BUFFER, 0);
     }
     
-    if (numVertices > 0 && attribute_v_normal != -1) {
-        fghGenBuffers(1, &vbo_normals);
-        fghBindBuffer(FGH_ARRAY_BUFFER, vbo_normals);
+    if (numVertices > 0 && (attribute_v_normal != -1 || fghGeometryCacheKey)) {
+        fghGenBuffers(1, &buffers.vbo_normals);
+        fghBindBuffer(FGH_ARRAY_BUFFER, buffers.vbo_normals);
         fghBufferData(FGH_ARRAY_BUFFER, numVertices * 3 * sizeof(normals[0]),
                       normals, FGH_STATIC_DRAW);
-        fghBindBuffer(FGH_ARRAY_BUFFER, 0);
-    }
-
-    if (numVertices > 0 && attribute_v_texture != -1 && textcs) {
-        fghGenBuffers(1, &vbo_textcs);
-        fghBindBuffer(FGH_ARRAY_BUFFER, vbo_textcs);
-        fghBufferData(FGH_ARRAY_BUFFER, numVertices * 2 * sizeof(textcs[0]),
-                      textcs, FGH_STATIC_DRAW);
-        fghBindBuffer(FGH_ARRAY_BUFFER, 0);
     }
     
     if (vertIdxs != NULL) {
-        fghGenBuffers(1, &ibo_elements);
-        fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, ibo_elements);
+        fghGenBuffers(1, &buffers.ibo_elements);
+        fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, buffers.ibo_elements);
         fghBufferData(FGH_ELEMENT_ARRAY_BUFFER, numVertIdxs * sizeof(vertIdxs[0]),
                       vertIdxs, FGH_STATIC_DRAW);
         fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, 0);
     }
-    
-    if (vbo_coords) {
+
+    if (vertIdxs2 != NULL) {
+        fghGenBuffers(1, &buffers.ibo_elements2);
+        fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, buffers.ibo_elements2);
+        fghBufferData(FGH_ELEMENT_ARRAY_BUFFER, numVertIdxs2 * sizeof(vertIdxs2[0]),
+                      vertIdxs2, FGH_STATIC_DRAW);
+        fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, 0);
+    }
+
+    fghDrawGeometryBuffersWire20(&buffers, attribute_v_coord, attribute_v_normal);
+
+    if (fghGeometryCacheKey)
+        fghStoreGeometry(fghGeometryCacheKey, &buffers);
+    else
+        fghDeleteGeometryBuffers(&buffers);
+}
+
+
+
+
+/* Version for OpenGL (ES) >= 2.0 */
+static void fghDrawGeometryBuffersSolid20(const SFG_GeometryBuffers *buffers,
+                                          GLint attribute_v_coord, GLint attribute_v_normal, GLint attribute_v_texture)
+{
+    int i;
+
+    if (buffers->vbo_coords && attribute_v_coord != -1) {
         fghEnableVertexAttribArray(attribute_v_coord);
-        fghBindBuffer(FGH_ARRAY_BUFFER, vbo_coords);
+        fghBindBuffer(FGH_ARRAY_BUFFER, buffers->vbo_coords);
         fghVertexAttribPointer(
             attribute_v_coord,  /* attribute */
             3,                  /* number of elements per vertex, here (x,y,z) */
@@ -441,9 +639,9 @@ static void fghDrawGeometrySolid20(GLfloat *vertices, GLfloat *normals, GLfloat
         fghBindBuffer(FGH_ARRAY_BUFFER, 0);
     };
     
-    if (vbo_normals) {
+    if (buffers->vbo_normals && attribute_v_normal != -1) {
         fghEnableVertexAttribArray(attribute_v_normal);
-        fghBindBuffer(FGH_ARRAY_BUFFER, vbo_normals);
+        fghBindBuffer(FGH_ARRAY_BUFFER, buffers->vbo_normals);
         fghVertexAttribPointer(
             attribute_v_normal, /* attribute */
             3,                  /* number of elements per vertex, here (x,y,z) */
@@ -455,9 +653,9 @@ static void fghDrawGeometrySolid20(GLfloat *vertices, GLfloat *normals, GLfloat
         fghBindBuffer(FGH_ARRAY_BUFFER, 0);
     };
 
-    if (vbo_textcs) {
+    if (buffers->vbo_textcs && attribute_v_texture != -1) {
         fghEnableVertexAttribArray(attribute_v_texture);
-        fghBindBuffer(FGH_ARRAY_BUFFER, vbo_textcs);
+        fghBindBuffer(FGH_ARRAY_BUFFER, buffers->vbo_textcs);
         fghVertexAttribPointer(
             attribute_v_texture,/* attribute */
             2,                  /* number of elements per vertex, here (s,t) */
@@ -469,37 +667,81 @@ static void fghDrawGeometrySolid20(GLfloat *vertices, GLfloat *normals, GLfloat
         fghBindBuffer(FGH_ARRAY_BUFFER, 0);
     };
     
-    if (vertIdxs == NULL) {
-        glDrawArrays(GL_TRIANGLES, 0, numVertices);
+    if (!buffers->ibo_elements) {
+        glDrawArrays(GL_TRIANGLES, 0, buffers->numVertices);
     } else {
-        fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, ibo_elements);
-        if (numParts>1) {
-            for (i=0; i<numParts; i++) {
-                glDrawElements(GL_TRIANGLE_STRIP, numVertIdxsPerPart, GL_UNSIGNED_SHORT, (GLvoid*)(sizeof(vertIdxs[0])*i*numVertIdxsPerPart));
+        fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, buffers->ibo_elements);
+        if (buffers->numParts>1) {
+            for (i=0; i<buffers->numParts; i++) {
+                glDrawElements(GL_TRIANGLE_STRIP, buffers->numVertPerPart, GL_UNSIGNED_SHORT, (GLvoid*)(sizeof(GLushort)*i*buffers->numVertPerPart));
             }
         } else {
-            glDrawElements(GL_TRIANGLES, numVertIdxsPerPart, GL_UNSIGNED_SHORT, 0);
+            glDrawElements(GL_TRIANGLES, buffers->numVertPerPart, GL_UNSIGNED_SHORT, 0);
         }
         /* Clean existing bindings before clean-up */
         /* Android showed instability otherwise */
         fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, 0);
     }
     
-    if (vbo_coords != 0)
+    if (buffers->vbo_coords && attribute_v_coord != -1)
         fghDisableVertexAttribArray(attribute_v_coord);
-    if (vbo_normals != 0)
+    if (buffers->vbo_normals && attribute_v_normal != -1)
         fghDisableVertexAttribArray(attribute_v_normal);
-    if (vbo_textcs != 0)
+    if (buffers->vbo_textcs && attribute_v_texture != -1)
         fghDisableVertexAttribArray(attribute_v_texture);
+}
+
+static void fghDrawGeometrySolid20(GLfloat *vertices, GLfloat *normals, GLfloat *textcs, GLsizei numVertices,
+                                   GLushort *vertIdxs, GLsizei numParts, GLsizei numVertIdxsPerPart,
+                                   GLint attribute_v_coord, GLint attribute_v_normal, GLint attribute_v_texture)
+{
+    SFG_GeometryBuffers buffers;
+    GLsizei numVertIdxs = numParts * numVertIdxsPerPart;
+
+    memset(&buffers, 0, sizeof(buffers));
+    buffers.numVertices    = numVertices;
+    buffers.numParts       = numParts;
+    buffers.numVertPerPart = numVertIdxsPerPart;
+  
+    /* buffers kept in the cache have all attributes, later draws may use them */
+    if (numVertices > 0 && (attribute_v_coord != -1 || fghGeometryCacheKey)) {
+        fghGenBuffers(1, &buffers.vbo_coords);
+        fghBindBuffer(FGH_ARRAY_BUFFER, buffers.vbo_coords);
+        fghBufferData(FGH_ARRAY_BUFFER, numVertices * 3 * sizeof(vertices[0]),
+                      vertices, FGH_STATIC_DRAW);
+        fghBindBuffer(FGH_ARRAY_BUFFER, 0);
+    }
     
-    if (vbo_coords != 0)
-        fghDeleteBuffers(1, &vbo_coords);
-    if (vbo_normals != 0)
-        fghDeleteBuffers(1, &vbo_normals);
-    if (vbo_textcs != 0)
-        fghDeleteBuffers(1, &vbo_textcs);
-    if (ibo_elements != 0)
-        fghDeleteBuffers(1, &ibo_elements);
+    if (numVertices > 0 && (attribute_v_normal != -1 || fghGeometryCacheKey)) {
+        fghGenBuffers(1, &buffers.vbo_normals);
+        fghBindBuffer(FGH_ARRAY_BUFFER, buffers.vbo_normals);
+        fghBufferData(FGH_ARRAY_BUFFER, numVertices * 3 * sizeof(normals[0]),
+                      normals, FGH_STATIC_DRAW);
+        fghBindBuffer(FGH_ARRAY_BUFFER, 0);
+    }
+
+    if (numVertices > 0 && (attribute_v_texture != -1 || fghGeometryCacheKey) && textcs) {
+        fghGenBuffers(1, &buffers.vbo_textcs);
+        fghBindBuffer(FGH_ARRAY_BUFFER, buffers.vbo_textcs);
+        fghBufferData(FGH_ARRAY_BUFFER, numVertices * 2 * sizeof(textcs[0]),
+                      textcs, FGH_STATIC_DRAW);
+        fghBindBuffer(FGH_ARRAY_BUFFER, 0);
+    }
+    
+    if (vertIdxs != NULL) {
+        fghGenBuffers(1, &buffers.ibo_elements);
+        fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, buffers.ibo_elements);
+        fghBufferData(FGH_ELEMENT_ARRAY_BUFFER, numVertIdxs * sizeof(vertIdxs[0]),
+                      vertIdxs, FGH_STATIC_DRAW);
+        fghBindBuffer(FGH_ELEMENT_ARRAY_BUFFER, 0);
+    }
+
+    fghDrawGeometryBuffersSolid20(&buffers, attribute_v_coord, attribute_v_normal, attribute_v_texture);
+
+    if (fghGeometryCacheKey)
+        fghStoreGeometry(fghGeometryCacheKey, &buffers);
+    else
+        fghDeleteGeometryBuffers(&buffers);
 }
 
 
@@ -1605,6 +1847,12 @@ static void fghSphere( GLfloat radius, GLint slices, GLint stacks, GLboolean use
 {
     int i,j,idx, nVert;
     GLfloat *vertices, *normals;
+    SFG_GeometryKey key;
+
+    /* Reuse the buffer objects of an earlier call with the same parameters */
+    fghInitGeometryKey(&key, FGH_SHAPE_SPHERE, useWireMode, radius, 0.f, slices, stacks);
+    if (fghDrawCachedGeometry(&key))
+        return;
 
     /* Generate vertices and normals */
     fghGenerateSphere(radius,slices,stacks,&vertices,&normals,&nVert);
@@ -1653,9 +1901,11 @@ static void fghSphere( GLfloat radius, GLint slices, GLint stacks, GLboolean use
         }
 
         /* draw */
+        fghBeginCachedGeometry(&key);
         fghDrawGeometryWire(vertices,normals,nVert,
             sliceIdx,slices,stacks+1,GL_LINE_STRIP,
             stackIdx,stacks-1,slices);
+        fghEndCachedGeometry();
         
         /* cleanup allocated memory */
         free(sliceIdx);
@@ -1715,7 +1965,9 @@ static void fghSphere( GLfloat radius, GLint slices, GLint stacks, GLboolean use
 
 
         /* draw */
+        fghBeginCachedGeometry(&key);
         fghDrawGeometrySolid(vertices,normals,NULL,nVert,stripIdx,stacks,(slices+1)*2);
+        fghEndCachedGeometry();
 
         /* cleanup allocated memory */
         free(stripIdx);
@@ -1730,6 +1982,12 @@ static void fghCone( GLfloat base, GLfloat height, GLint slices, GLint stacks, G
 {
     int i,j,idx, nVert;
     GLfloat *vertices, *normals;
+    SFG_GeometryKey key;
+
+    /* Reuse the buffer objects of an earlier call with the same parameters */
+    fghInitGeometryKey(&key, FGH_SHAPE_CONE, useWireMode, base, height, slices, stacks);
+    if (fghDrawCachedGeometry(&key))
+        return;
 
     /* Generate vertices and normals */
     /* Note, (stacks+1)*slices vertices for side of object, slices+1 for top and bottom closures */
@@ -1775,9 +2033,11 @@ static void fghCone( GLfloat base, GLfloat height, GLint slices, GLint stacks, G
         }
 
         /* draw */
+        fghBeginCachedGeometry(&key);
         fghDrawGeometryWire(vertices,normals,nVert,
             sliceIdx,1,slices*2,GL_LINES,
             stackIdx,stacks,slices);
+        fghEndCachedGeometry();
 
         /* cleanup allocated memory */
         free(sliceIdx);
@@ -1826,7 +2086,9 @@ static void fghCone( GLfloat base, GLfloat height, GLint slices, GLint stacks, G
         }
 
         /* draw */
+        fghBeginCachedGeometry(&key);
         fghDrawGeometrySolid(vertices,normals,NULL,nVert,stripIdx,stacks+1,(slices+1)*2);
+        fghEndCachedGeometry();
 
         /* cleanup allocated memory */
         free(stripIdx);
@@ -1841,6 +2103,12 @@ static void fghCylinder( GLfloat radius, GLfloat height, GLint slices, GLint sta
 {
     int i,j,idx, nVert;
     GLfloat *vertices, *normals;
+    SFG_GeometryKey key;
+
+    /* Reuse the buffer objects of an earlier call with the same parameters */
+    fghInitGeometryKey(&key, FGH_SHAPE_CYLINDER, useWireMode, radius, height, slices, stacks);
+    if (fghDrawCachedGeometry(&key))
+        return;
 
     /* Generate vertices and normals */
     /* Note, (stacks+1)*slices vertices for side of object, 2*slices+2 for top and bottom closures */
@@ -1886,9 +2154,11 @@ static void fghCylinder( GLfloat radius, GLfloat height, GLint slices, GLint sta
         }
 
         /* draw */
+        fghBeginCachedGeometry(&key);
         fghDrawGeometryWire(vertices,normals,nVert,
             sliceIdx,1,slices*2,GL_LINES,
             stackIdx,stacks+1,slices);
+        fghEndCachedGeometry();
 
         /* cleanup allocated memory */
         free(sliceIdx);
@@ -1947,7 +2217,9 @@ static void fghCylinder( GLfloat radius, GLfloat height, GLint slices, GLint sta
         stripIdx[idx+1] = nVert-1;                  /* repeat first slice's idx for closing off shape */
 
         /* draw */
+        fghBeginCachedGeometry(&key);
         fghDrawGeometrySolid(vertices,normals,NULL,nVert,stripIdx,stacks+2,(slices+1)*2);
+        fghEndCachedGeometry();
 
         /* cleanup allocated memory */
         free(stripIdx);
@@ -1962,6 +2234,12 @@ static void fghTorus( GLfloat dInnerRadius, GLfloat dOuterRadius, GLint nSides,
 {
     int i,j,idx, nVert;
     GLfloat *vertices, *normals;
+    SFG_GeometryKey key;
+
+    /* Reuse the buffer objects of an earlier call with the same parameters */
+    fghInitGeometryKey(&key, FGH_SHAPE_TORUS, useWireMode, dInnerRadius, dOuterRadius, nSides, nRings);
+    if (fghDrawCachedGeometry(&key))
+        return;
 
     /* Generate vertices and normals */
     fghGenerateTorus(dInnerRadius,dOuterRadius,nSides,nRings, &vertices,&normals,&nVert);
@@ -1998,9 +2276,11 @@ static void fghTorus( GLfloat dInnerRadius, GLfloat dOuterRadius, GLint nSides,
                 sideIdx[idx] = j * nSides + i;
 
         /* draw */
+        fghBeginCachedGeometry(&key);
         fghDrawGeometryWire(vertices,normals,nVert,
             ringIdx,nRings,nSides,GL_LINE_LOOP,
             sideIdx,nSides,nRings);
+        fghEndCachedGeometry();
         
         /* cleanup allocated memory */
         free(sideIdx);
@@ -2041,7 +2321,9 @@ static void fghTorus( GLfloat dInnerRadius, GLfloat dOuterRadius, GLint nSides,
         }
 
         /* draw */
+        fghBeginCachedGeometry(&key);
         fghDrawGeometrySolid(vertices,normals,NULL,nVert,stripIdx,nSides,(nRings+1)*2);
+        fghEndCachedGeometry();
 
         /* cleanup allocated memory */
         free(stripIdx);
@@ -2056,6 +2338,24 @@ static void fghTorus( GLfloat dInnerRadius, GLfloat dOuterRadius, GLint nSides,
 /* -- INTERFACE FUNCTIONS ---------------------------------------------- */
 
 
+/*
+ * Frees the buffer objects of all shapes cached for the current window
+ */
+void FGAPIENTRY glutFlushGeometryCache( void )
+{
+    int i;
+
+    FREEGLUT_EXIT_IF_NOT_INITIALISED ( "glutFlushGeometryCache" );
+
+    if (!fgStructure.CurrentWindow)
+        return;
+
+    for (i=fghGeometryCacheCount-1; i>=0; i--)
+        if (fghGeometryCache[i].Key.WindowID == fgStructure.CurrentWindow->ID)
+            fghRemoveGeometryCacheEntry(i, GL_TRUE);
+}
+
+
 /*
  * Draws a solid sphere
  */
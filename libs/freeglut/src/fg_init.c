@@ -88,6 +88,7 @@ SFG_State fgState = { { -1, -1, GL_FALSE },  /* Position */
                       4,                      /* SampleNumber */
                       GL_FALSE,               /* SkipStaleMotion */
                       GL_FALSE,               /* StrokeFontDrawJoinDots */
+                      128,                    /* GeometryCacheSize */
                       1,                      /* OpenGL context MajorVersion */
                       0,                      /* OpenGL context MinorVersion */
                       0,                      /* OpenGL ContextFlags */
@@ -244,6 +245,7 @@ void fgDeinitialize( void )
     }
 
     fgDestroyStructure( );
+    fgDropGeometryCache( NULL );
 
     while( ( timer = fgState.Timers.First) )
     {
@@ -344,6 +344,8 @@ struct tagSFG_State
 
     GLboolean        StrokeFontDrawJoinDots;/* Draw dots between line segments of stroke fonts? */
 
+    int              GeometryCacheSize;    /* Max. number of cached shapes (fg_geometry.c) */
+
     int              MajorVersion;         /* Major OpenGL context version  */
     int              MinorVersion;         /* Minor OpenGL context version  */
     int              ContextFlags;         /* OpenGL context flags          */
@@ -1048,6 +1050,13 @@ fg_time_t fgElapsedTime( void );
 /* System time in milliseconds */
 fg_time_t fgSystemTime(void);
 
+/*
+ * Buffer objects of shapes kept between draw calls, defined in fg_geometry.c.
+ * Drops the entries of a window (all windows if NULL) without GL calls,
+ * as its context is about to be destroyed.
+ */
+void fgDropGeometryCache( SFG_Window *window );
+
 /* List functions */
 void fgListInit(SFG_List *list);
 void fgListAppend(SFG_List *list, SFG_Node *node);
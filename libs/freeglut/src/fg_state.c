@@ -122,6 +122,11 @@ void FGAPIENTRY glutSetOption( GLenum eWhat, int value )
       fgState.StrokeFontDrawJoinDots = !!value;
       break;
 
+    case GLUT_GEOMETRY_CACHE_SIZE:
+      /* shrinking takes effect on the next cached draw */
+      fgState.GeometryCacheSize = value < 0 ? 0 : value;
+      break;
+
     default:
         fgWarning( "glutSetOption(): missing enum handle %d", eWhat );
         break;
@@ -225,6 +230,9 @@ int FGAPIENTRY glutGet( GLenum eWhat )
     case GLUT_STROKE_FONT_DRAW_JOIN_DOTS:
         return fgState.StrokeFontDrawJoinDots;
 
+    case GLUT_GEOMETRY_CACHE_SIZE:
+        return fgState.GeometryCacheSize;
+
     default:
         return fgPlatformGlutGet ( eWhat );
         break;
@@ -216,6 +216,7 @@ void fgDestroyWindow( SFG_Window* window )
       fgDeactivateMenu( window );
 
     fghClearCallBacks( window );
+    fgDropGeometryCache( window );
     fgCloseWindow( window );
     free( window );
     if( fgStructure.CurrentWindow == window )
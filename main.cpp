@@ -1,62 +1,532 @@
 #include <iostream>
+#include <vector>
+#include <memory>
+#include <cstdlib>
 #include <GL/glew.h>
 #include <GL/freeglut.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
 #include "GLSLProgram.h"
+#include "Icosphere.h"
+#include "LatticeSphere.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "VertexPacking.h"
+#include "IndexBuffer.h"
+#include "GeometryPool.h"
+#include "VertexFormat.h"
+#include "Benchmark.h"
+#include "UniformBuffer.h"
+#include "GLState.h"
+#include "Frustum.h"
+#include "BVH.h"
+#include "LevelOfDetail.h"
+#include "SoftwareRasterizer.h"
+#include "HeadlessContext.h"
 
 const int WINDOW_WIDTH = 640;
 const int WINDOW_HEIGHT = 480;
 int glutID = 0;
+const int MAX_RECURSION_LEVEL = 7; // level 7 has 163842 vertices, i.e. needs 32 bit indices
+const char* SHADER_CACHE_DIR = "shadercache"; // program binaries, keyed by driver and shader sources
+const int INSTANCE_GRID = 47; // instanced mode: 47^3 = 103823 spheres
+cg::HeadlessContext headlessContext; // --headless: EGL context and framebuffer object instead of the window, destroyed last
+int headlessFrames = 0;           // frames to render headless, 0: window
+std::string headlessImage;        // --headless-image=file.ppm: last headless frame
 cg::GLSLProgram program;
+cg::GLSLProgram instancedProgram; // shader/instanced.vert, sphere center and radius per instance
+cg::GLSLProgram packedProgram;    // shader/packed.vert, Sphere with --packed-vertices, with and without instances
+cg::GLSLProgram tessellatedProgram; // shader/tessellated.*, refines the icosahedron on the GPU
 glm::mat4x4 view;
 glm::mat4x4 projection;
+cg::UniformBuffer frameConstants; // view and projection, shared by all programs
+bool instanced = false;           // draw the INSTANCE_GRID with one draw call instead of one sphere
+std::vector<glm::vec4> grid;      // all instances, only the visible ones are uploaded
+cg::BVH gridTree;                 // of grid, same ids: culling and picking
+glm::mat4 culledWith(0.0f);       // model-view-projection of the last culling
+const size_t TRIANGLE_BUDGET = 4000000; // per frame, for the automatic level of detail
+bool automaticLod = true;         // level per sphere from its size on screen, '+'/'-' switch to manual
+float viewportHeight = float(WINDOW_HEIGHT);
+bool latticeSpheres = false;      // --lattice: Sphere levels generated by LatticeSphere instead of subdivided
+bool packVertices = false;        // --packed-vertices[=half]: 16 instead of 24 bytes per sphere vertex
+bool halfPositions = false;       // positions as half instead of unorm16
+bool optimizeMeshes = false;      // --optimize-meshes: vertex cache and vertex fetch order of all sphere levels
+bool meshletCulling = false;      // --meshlets: single sphere drawn by meshlets, hidden and back-facing ones skipped
+bool tessellated = false;         // single sphere: tessellation shaders instead of the CPU levels
+const float PIXELS_PER_EDGE = 8.0f; // target triangle edge length on screen of both sphere paths
+cg::LevelOfDetail gridLod;        // per grid instance
+cg::LevelOfDetail::Selection gridSelection; // visible instances by level, in instanceBuffer order
+cg::LevelOfDetail sphereLod;      // the single sphere
+
+// position and color interleaved, per instance center and radius
+const cg::VertexFormat sphereFormat = cg::VertexFormat().add<glm::vec3>("position").add<glm::vec3>("color");
+const cg::VertexFormat instanceFormat = cg::VertexFormat().add<glm::vec4>("instance");
+const cg::VertexFormat positionFormat = cg::VertexFormat().add<glm::vec3>("position");
+
+// unorm16 or half position, octahedral normal, RGBA8 color (cg::VertexPacking)
+cg::VertexFormat packedFormat() {
+    cg::VertexFormat format;
+    if (halfPositions) {
+        format.add("position", 4, GL_HALF_FLOAT);
+    }
+    else {
+        format.add<glm::u16vec4>("position");
+    }
+    return format.add<glm::i16vec2>("normal").add<glm::u8vec4>("color");
+}
 
 // Einfache Kugel-Klasse mit Tessellation
 class Sphere {
 public:
-    GLuint vao;
-    GLuint vertexBuffer;
-    GLuint indexBuffer;
-    int indicesCount;
+    std::unique_ptr<cg::GeometryPool> pool; // mesh n: level n, all levels in one vertex and one index buffer
+    int level;
     glm::mat4 modelMatrix;
+    GLuint instanceVao;          // pool buffers for instancedProgram, plus instanceBuffer
+    GLuint instanceBuffer;
+    GLsizei instanceCount;
+    cg::VertexPacking::Bounds bounds; // packed positions: decoded with bounds.scale() and bounds.offset()
+    cg::Meshlets meshlets;       // one mesh per level, with --meshlets
+    cg::IndexBuffer meshletIndices; // all levels in one chunk: one index type for glMultiDrawElementsIndirect
+    GLuint meshletVao;           // pool vertex buffer, meshletIndices
+    GLuint commandBuffer;
+    std::vector<cg::GeometryPool::DrawCommand> commands; // visible meshlets of the current draw
 
-    Sphere() : vao(0), vertexBuffer(0), indexBuffer(0), indicesCount(0) {}
+    Sphere() : level(0), instanceVao(0), instanceBuffer(0), instanceCount(0),
+               meshletIndices(0), meshletVao(0), commandBuffer(0) {}
 
     void init(int recursionLevel) {
-        // Tessellation und Aufbau der Kugel hier einfgen
+        // All levels live in one buffer pair, uploaded once. Switching levels only changes the draw range.
+        const cg::Icosphere& icosphere = cg::Icosphere::shared(MAX_RECURSION_LEVEL);
+        if (!pool) {
+            upload(icosphere);
+        }
+        level = glm::clamp(recursionLevel, 0, icosphere.maxLevel());
+    }
+
+    // the sphere at its level: one command of the pool, or the visible meshlets
+    void draw() {
+        if (meshletCulling) {
+            use(packVertices ? packedProgram : program);
+            if (packVertices) {
+                // packed.vert also draws instances, without them it needs the identity instance
+                GLint instance = glGetAttribLocation(packedProgram.getHandle(), "instance");
+                if (instance >= 0) {
+                    glVertexAttrib4f(instance, 0.0f, 0.0f, 0.0f, 1.0f);
+                }
+            }
+            drawMeshlets();
+            return;
+        }
+        begin();
+        add(level, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+        flush();
+    }
+
+    // Many spheres with one glMultiDrawElementsIndirect: begin, add per sphere, flush.
+    // instance: xyz center, w radius in model space
+    void begin() {
+        pool->begin();
+    }
+
+    void add(int n, const glm::vec4& instance) {
+        pool->draw(size_t(n), instance);
+    }
+
+    void flush() {
+        // view and projection come from the FrameConstants block
+        use(packVertices ? packedProgram : instancedProgram);
+        pool->flush();
+    }
+
+    // xyz: center, w: radius of every instance (in model space). Call after init.
+    void setInstances(const std::vector<glm::vec4>& instances) {
+        if (instanceVao == 0) {
+            glGenVertexArrays(1, &instanceVao);
+            cg::GLState::bindVertexArray(instanceVao);
+            cg::GLState::bindBuffer(GL_ARRAY_BUFFER, pool->getVertexBuffer());
+            if (packVertices) {
+                packedFormat().setup(packedProgram);
+            }
+            else {
+                sphereFormat.setup(instancedProgram);
+            }
+            glGenBuffers(1, &instanceBuffer);
+            cg::GLState::bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+            instanceFormat.setup(packVertices ? packedProgram : instancedProgram, 0, 1);
+            cg::GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool->getIndexBuffer());
+        }
+        else {
+            cg::GLState::bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        }
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(glm::vec4), instances.data(), GL_STATIC_DRAW);
+        cg::GLState::bindVertexArray(0);
+        instanceCount = GLsizei(instances.size());
     }
 
-    void draw(glm::mat4 projection, glm::mat4 view) {
-        glm::mat4 mvp = projection * view * modelMatrix;
-        program.use();
-        program.setUniform("mvp", mvp);
-        glBindVertexArray(vao);
-        glDrawElements(GL_TRIANGLES, indicesCount, GL_UNSIGNED_SHORT, 0);
-        glBindVertexArray(0);
+    // all instances with one draw call
+    void drawInstanced() {
+        use(packVertices ? packedProgram : instancedProgram);
+        cg::GLState::bindVertexArray(instanceVao);
+        pool->drawInstanced(size_t(level), instanceCount);
+    }
+
+    // one draw call per level: instances first[n] .. first[n + 1] - 1 with level n
+    void drawInstanced(const std::vector<uint32_t>& first) {
+        use(packVertices ? packedProgram : instancedProgram);
+        cg::GLState::bindVertexArray(instanceVao);
+        for (size_t n = 0; n + 1 < first.size(); n++) {
+            if (first[n + 1] > first[n]) {
+                pool->drawInstanced(n, GLsizei(first[n + 1] - first[n]), first[n]);
+            }
+        }
     }
 
     ~Sphere() {
-        glDeleteVertexArrays(1, &vao);
-        glDeleteBuffers(1, &vertexBuffer);
-        glDeleteBuffers(1, &indexBuffer);
+        cg::GLState::deleteVertexArrays(1, &instanceVao);
+        cg::GLState::deleteVertexArrays(1, &meshletVao);
+        cg::GLState::deleteBuffers(1, &instanceBuffer);
+        cg::GLState::deleteBuffers(1, &commandBuffer);
+    }
+
+private:
+    void use(cg::GLSLProgram& shader) {
+        shader.use();
+        shader.setUniform("model", modelMatrix);
+        if (packVertices) {
+            shader.setUniform("positionScale", bounds.scale());
+            shader.setUniform("positionOffset", bounds.offset());
+        }
+    }
+
+    // Meshlets of the level that are in the frustum and not back-facing, culled in model space,
+    // with one glMultiDrawElementsIndirect.
+    void drawMeshlets() {
+        const glm::mat4 modelView = view * modelMatrix;
+        const glm::vec3 camera = glm::vec3(glm::inverse(modelView)[3]);
+        const cg::IndexBuffer::Chunk& chunk = meshletIndices.chunks(0)[0];
+        commands.clear();
+        meshlets.cull(level, cg::Frustum(projection * modelView), camera, commands,
+                      GLuint(chunk.offset / cg::IndexBuffer::typeSize(chunk.type)), chunk.baseVertex);
+        if (commands.empty()) {
+            return;
+        }
+        cg::GLState::bindVertexArray(meshletVao);
+        cg::GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(cg::GeometryPool::DrawCommand), commands.data(), GL_STREAM_DRAW);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, chunk.type, nullptr, GLsizei(commands.size()), 0);
+    }
+
+    void upload(const cg::Icosphere& icosphere) {
+        // level n: indices [first[n], first[n + 1]), relative to the vertices [base[n], base[n] + vertexCount[n]).
+        // Icosphere levels share a vertex prefix, lattice levels get one vertex block each.
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+        std::vector<size_t> first(1, 0);
+        std::vector<GLint> base;
+        std::vector<GLuint> vertexCount;
+        for (int n = 0; n <= icosphere.maxLevel(); n++) {
+            std::vector<uint32_t> level;
+            if (latticeSpheres) {
+                std::vector<glm::vec3> block(cg::LatticeSphere::vertexCount(1 << n));
+                level.resize(cg::LatticeSphere::indexCount(1 << n));
+                cg::LatticeSphere::generate(1 << n, block.data(), level.data());
+                if (optimizeMeshes) {
+                    cg::MeshOptimizer::optimizeVertexCache(level, block.size());
+                    std::vector<uint32_t> remap;
+                    cg::MeshOptimizer::optimizeVertexFetch(level, block.size(), remap);
+                    cg::MeshOptimizer::remapVertices(block, remap);
+                }
+                if (meshletCulling) {
+                    meshlets.add(level.data(), level.size(), block.data(), block.size(), uint32_t(indices.size()));
+                }
+                base.push_back(GLint(positions.size()));
+                vertexCount.push_back(GLuint(block.size()));
+                positions.insert(positions.end(), block.begin(), block.end());
+            }
+            else {
+                const cg::Icosphere::Level& range = icosphere.level(n);
+                level.assign(icosphere.getIndices().begin() + range.firstIndex,
+                             icosphere.getIndices().begin() + range.firstIndex + range.indexCount);
+                if (optimizeMeshes) {
+                    // the vertices are shared with the other levels, only the triangles are reordered
+                    cg::MeshOptimizer::optimizeVertexCache(level, range.vertexCount);
+                }
+                if (meshletCulling) {
+                    // meshlet order replaces the cache order, it is local as well
+                    meshlets.add(level.data(), level.size(), icosphere.getVertices().data(), range.vertexCount, uint32_t(indices.size()));
+                }
+                base.push_back(0);
+                vertexCount.push_back(GLuint(range.vertexCount));
+            }
+            indices.insert(indices.end(), level.begin(), level.end());
+            first.push_back(indices.size());
+        }
+        if (!latticeSpheres) {
+            positions = icosphere.getVertices();
+        }
+
+        // the color is derived from the normal
+        std::vector<glm::vec3> colors;
+        colors.reserve(positions.size());
+        for (const glm::vec3& p : positions) {
+            colors.push_back(p * 0.5f + 0.5f);
+        }
+        std::vector<uint8_t> vertices;
+        if (packVertices) {
+            // the normals of the unit sphere are the positions
+            std::vector<glm::u16vec4> packedPositions(positions.size());
+            std::vector<glm::i16vec2> packedNormals(positions.size());
+            std::vector<glm::u8vec4> packedColors(positions.size());
+            if (halfPositions) {
+                bounds.min = glm::vec3(0.0f);
+                bounds.max = glm::vec3(1.0f); // scale 1, offset 0
+                cg::VertexPacking::packPositionsHalf(positions.data(), positions.size(), packedPositions.data());
+            }
+            else {
+                bounds = cg::VertexPacking::bounds(positions.data(), positions.size());
+                cg::VertexPacking::packPositions(positions.data(), positions.size(), bounds, packedPositions.data());
+            }
+            cg::VertexPacking::packNormals(positions.data(), positions.size(), packedNormals.data());
+            cg::VertexPacking::packColors(colors.data(), colors.size(), packedColors.data());
+            vertices = packedFormat().interleave(packedPositions, packedNormals, packedColors);
+        }
+        else {
+            vertices = sphereFormat.interleave(positions, colors);
+        }
+
+        // the programs with the instance attribute: a single sphere is the instance (0, 0, 0, 1)
+        pool.reset(new cg::GeometryPool(packVertices ? packedFormat() : sphereFormat, instanceFormat));
+        pool->addVertices(vertices.data(), positions.size());
+        for (int n = 0; n <= icosphere.maxLevel(); n++) {
+            pool->addMesh(base[n], vertexCount[n], &indices[first[n]], first[n + 1] - first[n]);
+        }
+        pool->upload(packVertices ? packedProgram : instancedProgram);
+
+        if (meshletCulling) {
+            glGenVertexArrays(1, &meshletVao);
+            cg::GLState::bindVertexArray(meshletVao);
+            cg::GLState::bindBuffer(GL_ARRAY_BUFFER, pool->getVertexBuffer());
+            if (packVertices) {
+                packedFormat().setup(packedProgram);
+            }
+            else {
+                sphereFormat.setup(program);
+            }
+            // one chunk for all levels: indices relative to the whole vertex buffer
+            std::vector<uint32_t> absolute(indices);
+            for (int n = 0; n <= icosphere.maxLevel(); n++) {
+                for (size_t i = first[n]; i < first[n + 1]; i++) {
+                    absolute[i] += uint32_t(base[n]);
+                }
+            }
+            meshletIndices.add(absolute);
+            meshletIndices.upload();
+            glGenBuffers(1, &commandBuffer);
+        }
+
+        cg::GLState::bindVertexArray(0);
+    }
+};
+
+// Sphere refined by the tessellation shaders: only the icosahedron (12 vertices, 20 patches) is uploaded,
+// the subdivision follows the distance every frame without any CPU work.
+class TessellatedSphere {
+public:
+    GLuint vao;
+    GLuint vertexBuffer;
+    cg::IndexBuffer indexBuffer;
+    glm::mat4 modelMatrix;
+
+    TessellatedSphere() : vao(0), vertexBuffer(0) {}
+
+    void init() {
+        const cg::Icosphere& icosahedron = cg::Icosphere::shared(0);
+        const cg::Icosphere::Level& faces = icosahedron.level(0);
+        const std::vector<glm::vec3> positions(icosahedron.getVertices().begin(), icosahedron.getVertices().begin() + 12);
+
+        glGenVertexArrays(1, &vao);
+        cg::GLState::bindVertexArray(vao);
+
+        glGenBuffers(1, &vertexBuffer);
+        cg::GLState::bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+        positionFormat.setup(tessellatedProgram);
+
+        indexBuffer.add(&icosahedron.getIndices()[faces.firstIndex], faces.indexCount);
+        indexBuffer.upload();
+
+        cg::GLState::bindVertexArray(0);
+    }
+
+    void draw() {
+        tessellatedProgram.use();
+        tessellatedProgram.setUniform("model", modelMatrix);
+        tessellatedProgram.setUniform("viewportHeight", viewportHeight);
+        tessellatedProgram.setUniform("pixelsPerEdge", PIXELS_PER_EDGE);
+        cg::GLState::bindVertexArray(vao);
+        glPatchParameteri(GL_PATCH_VERTICES, 3);
+        indexBuffer.draw(0, GL_PATCHES);
+    }
+
+    ~TessellatedSphere() {
+        cg::GLState::deleteVertexArrays(1, &vao);
+        cg::GLState::deleteBuffers(1, &vertexBuffer);
     }
 };
 
 Sphere sphere;
+TessellatedSphere tessellatedSphere;
 int recursionLevel = 0; // Tessellationsstufe
 
+// Spheres on a grid x grid x grid lattice filling [-1.5, 1.5]^3.
+std::vector<glm::vec4> gridInstances(int grid) {
+    std::vector<glm::vec4> instances;
+    instances.reserve(size_t(grid) * grid * grid);
+    float spacing = 3.0f / grid;
+    for (int z = 0; z < grid; z++) {
+        for (int y = 0; y < grid; y++) {
+            for (int x = 0; x < grid; x++) {
+                glm::vec3 center = (glm::vec3(x, y, z) + 0.5f) * spacing - 1.5f;
+                instances.push_back(glm::vec4(center, 0.4f * spacing));
+            }
+        }
+    }
+    return instances;
+}
+
+// The same spheres as one multi draw indirect of the pool (Sphere::add) and with one instanced draw call.
+void benchmarkInstancing(int grid, int frames = 20) {
+    const std::vector<glm::vec4> instances = gridInstances(grid);
+    sphere.setInstances(instances);
+    std::cout << "Instancing: " << instances.size() << " spheres, level " << sphere.level << ", "
+        << frames << " frames" << std::endl;
+
+    for (int mode = 0; mode < 2; mode++) {
+        cg::benchmark::GPUTimer gpuTimer;
+        cg::benchmark::Timer cpuTimer;
+        gpuTimer.begin();
+        for (int frame = 0; frame < frames; frame++) {
+            sphere.modelMatrix = glm::mat4(1.0f);
+            if (mode == 0) {
+                sphere.begin();
+                for (const glm::vec4& instance : instances) {
+                    sphere.add(sphere.level, instance);
+                }
+                sphere.flush();
+            }
+            else {
+                sphere.drawInstanced();
+            }
+        }
+        gpuTimer.end();
+        glFinish();
+        std::cout << (mode ? "  instanced " : "  pool      ") << "  gpu " << gpuTimer.ms() / frames
+            << " ms/frame  cpu " << cpuTimer.ms() / frames << " ms/frame" << std::endl;
+    }
+    sphere.modelMatrix = glm::mat4(1.0f);
+}
+
+// CPU levels chosen by sphereLod, all spheres in one multi draw indirect of the pool, vs. spheres
+// refined by the tessellation shaders, drawn one by one.
+void benchmarkTessellation(int grid = 10, int frames = 20) {
+    const std::vector<glm::vec4> instances = gridInstances(grid);
+    std::cout << "Tessellation: " << instances.size() << " spheres, " << frames << " frames" << std::endl;
+
+    // every instance keeps its own level (and hysteresis) under its id, as gridLod in display
+    std::vector<uint32_t> ids(instances.size());
+    for (uint32_t id = 0; id < ids.size(); id++) {
+        ids[id] = id;
+    }
+    cg::LevelOfDetail::Selection selection;
+    sphere.modelMatrix = glm::mat4(1.0f); // the instances are in world space
+
+    for (int mode = 0; mode < 2; mode++) {
+        cg::benchmark::GPUTimer gpuTimer;
+        cg::benchmark::Timer cpuTimer;
+        gpuTimer.begin();
+        for (int frame = 0; frame < frames; frame++) {
+            if (mode == 0) {
+                sphereLod.select(view, projection, viewportHeight, instances, ids, selection);
+                sphere.begin();
+                for (uint32_t id = 0; id < instances.size(); id++) {
+                    sphere.add(sphereLod.level(id), instances[id]);
+                }
+                sphere.flush();
+            }
+            else {
+                for (const glm::vec4& instance : instances) {
+                    tessellatedSphere.modelMatrix = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(instance)), glm::vec3(instance.w));
+                    tessellatedSphere.draw();
+                }
+            }
+        }
+        gpuTimer.end();
+        glFinish();
+        std::cout << (mode ? "  tessellation shaders" : "  CPU levels          ") << "  gpu " << gpuTimer.ms() / frames
+            << " ms/frame  cpu " << cpuTimer.ms() / frames << " ms/frame" << std::endl;
+    }
+    sphere.modelMatrix = glm::mat4(1.0f);
+    sphere.init(recursionLevel);
+    sphereLod.reset();
+}
+
 void display() {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    sphere.draw(projection, view);
-    glutSwapBuffers();
+
+    // once per frame for all objects and programs
+    cg::FrameConstants frame = { view, projection, projection * view };
+    frameConstants.update(frame);
+
+    if (instanced) {
+        // cull again only when the camera or the grid moved
+        glm::mat4 mvp = projection * view * sphere.modelMatrix;
+        if (mvp != culledWith) {
+            std::vector<uint32_t> visible;
+            gridTree.cull(cg::Frustum(mvp), visible);
+            if (automaticLod) {
+                gridLod.select(view * sphere.modelMatrix, projection, viewportHeight, grid, visible, gridSelection);
+                visible = gridSelection.ids;
+            }
+            std::vector<glm::vec4> instances;
+            instances.reserve(visible.size());
+            for (uint32_t id : visible) {
+                instances.push_back(grid[id]);
+            }
+            sphere.setInstances(instances);
+            culledWith = mvp;
+        }
+        if (automaticLod) {
+            sphere.drawInstanced(gridSelection.first);
+        }
+        else {
+            sphere.drawInstanced();
+        }
+    }
+    else if (tessellated) {
+        tessellatedSphere.modelMatrix = sphere.modelMatrix;
+        tessellatedSphere.draw();
+    }
+    else {
+        if (automaticLod) {
+            const std::vector<glm::vec4> unit(1, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+            cg::LevelOfDetail::Selection selection;
+            sphereLod.select(view * sphere.modelMatrix, projection, viewportHeight, unit, std::vector<uint32_t>(1, 0), selection);
+            sphere.init(sphereLod.level(0));
+        }
+        sphere.draw();
+    }
+    if (headlessFrames == 0) {
+        glutSwapBuffers();
+    }
 }
 
 void resize(int width, int height) {
     height = (height == 0) ? 1 : height;
     glViewport(0, 0, width, height);
     projection = glm::perspective(45.0f, float(width) / float(height), 0.1f, 100.0f);
+    viewportHeight = float(height);
+    culledWith = glm::mat4(0.0f); // select the levels again
 }
 
 void keyboard(unsigned char key, int x, int y) {
@@ -66,30 +536,80 @@ void keyboard(unsigned char key, int x, int y) {
         exit(0);
         break;
     case '+':
-        if (recursionLevel < 4) {
+        automaticLod = false;
+        culledWith = glm::mat4(0.0f);
+        if (recursionLevel < MAX_RECURSION_LEVEL) {
             recursionLevel++;
             sphere.init(recursionLevel);
         }
         break;
     case '-':
+        automaticLod = false;
+        culledWith = glm::mat4(0.0f);
         if (recursionLevel > 0) {
             recursionLevel--;
             sphere.init(recursionLevel);
         }
         break;
+    case 'i':
+        instanced = !instanced;
+        break;
+    case 't':
+        tessellated = !tessellated;
+        std::cout << "sphere: " << (tessellated ? "tessellation shaders" : "CPU levels") << std::endl;
+        break;
+    case 'l':
+        automaticLod = !automaticLod;
+        culledWith = glm::mat4(0.0f);
+        if (!automaticLod) {
+            sphere.init(recursionLevel);
+        }
+        std::cout << "level of detail: " << (automaticLod ? "automatic" : "manual") << std::endl;
+        break;
     }
     glutPostRedisplay();
 }
 
-bool init() {
-    glClearColor(0.2, 0.2, 0.2, 1);
-    glEnable(GL_DEPTH_TEST);
+// Left click in instanced mode: print the grid sphere under the mouse.
+void mouse(int button, int state, int x, int y) {
+    if (!instanced || button != GLUT_LEFT_BUTTON || state != GLUT_DOWN) {
+        return;
+    }
+
+    // unproject the pixel on the near and far plane into model space, where the grid lives
+    glm::vec4 viewport(0.0f, 0.0f, float(glutGet(GLUT_WINDOW_WIDTH)), float(glutGet(GLUT_WINDOW_HEIGHT)));
+    glm::vec3 window(float(x), viewport.w - float(y), 0.0f);
+    glm::mat4 modelView = view * sphere.modelMatrix;
+    glm::vec3 nearPoint = glm::unProject(window, modelView, projection, viewport);
+    window.z = 1.0f;
+    glm::vec3 farPoint = glm::unProject(window, modelView, projection, viewport);
+
+    cg::BVH::Hit hit = gridTree.raycast(nearPoint, farPoint - nearPoint, glm::length(farPoint - nearPoint));
+    if (hit.id == cg::BVH::NONE) {
+        std::cout << "picked nothing" << std::endl;
+    }
+    else {
+        const glm::vec4& picked = grid[hit.id];
+        std::cout << "picked sphere " << hit.id << " at (" << picked.x << ", " << picked.y << ", " << picked.z << ")" << std::endl;
+    }
+}
 
-    if (!program.compileShaderFromFile("vertex_shader.glsl", cg::GLSLShader::VERTEX)) {
+bool loadProgram(cg::GLSLProgram& program, const char* vertexShader, const char* fragmentShader,
+                 const char* controlShader = nullptr, const char* evaluationShader = nullptr) {
+    program.setBinaryCache(SHADER_CACHE_DIR);
+    if (!program.compileShaderFromFile(vertexShader, cg::GLSLShader::VERTEX)) {
         std::cerr << "Vertex shader compilation failed." << std::endl;
         return false;
     }
-    if (!program.compileShaderFromFile("fragment_shader.glsl", cg::GLSLShader::FRAGMENT)) {
+    if (controlShader && !program.compileShaderFromFile(controlShader, cg::GLSLShader::TESS_CONTROL)) {
+        std::cerr << "Tessellation control shader compilation failed." << std::endl;
+        return false;
+    }
+    if (evaluationShader && !program.compileShaderFromFile(evaluationShader, cg::GLSLShader::TESS_EVALUATION)) {
+        std::cerr << "Tessellation evaluation shader compilation failed." << std::endl;
+        return false;
+    }
+    if (!program.compileShaderFromFile(fragmentShader, cg::GLSLShader::FRAGMENT)) {
         std::cerr << "Fragment shader compilation failed." << std::endl;
         return false;
     }
@@ -97,28 +617,225 @@ bool init() {
         std::cerr << "Shader linking failed." << std::endl;
         return false;
     }
+    program.bindUniformBlock("FrameConstants", cg::FrameConstants::BINDING);
+    return true;
+}
+
+// The sphere of the window at the highest level rendered by cg::SoftwareRasterizer, without a GL context.
+bool renderSoftware(const std::string& filename) {
+    // camera of init and resize
+    view = glm::lookAt(glm::vec3(0.0f, 0.0f, 4.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    projection = glm::perspective(45.0f, float(WINDOW_WIDTH) / float(WINDOW_HEIGHT), 0.1f, 100.0f);
+
+    const cg::Icosphere& icosphere = cg::Icosphere::shared(MAX_RECURSION_LEVEL);
+    const cg::Icosphere::Level& level = icosphere.level(MAX_RECURSION_LEVEL);
+    std::vector<glm::vec3> colors;
+    colors.reserve(level.vertexCount);
+    for (size_t i = 0; i < level.vertexCount; i++) {
+        colors.push_back(icosphere.getVertices()[i] * 0.5f + 0.5f);
+    }
+
+    cg::SoftwareRasterizer rasterizer(WINDOW_WIDTH, WINDOW_HEIGHT);
+    cg::benchmark::Timer timer;
+    rasterizer.clear(glm::vec3(0.2f));
+    rasterizer.draw(projection * view * sphere.modelMatrix, icosphere.getVertices().data(), colors.data(), level.vertexCount,
+                    &icosphere.getIndices()[level.firstIndex], level.indexCount);
+    rasterizer.finish();
+    double ms = timer.ms();
+
+    const cg::SoftwareRasterizer::Statistics& statistics = rasterizer.getStatistics();
+    std::cout << "software: " << statistics.triangles << " triangles, " << statistics.fragments << " pixels in " << ms << " ms, "
+        << statistics.triangles / (ms * 1000.0) << " Mtriangles/s, " << statistics.fragments / (ms * 1000.0) << " Mpixels/s" << std::endl;
+    if (!rasterizer.writePPM(filename)) {
+        std::cerr << "Cannot write " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// --headless N: N frames of display into the framebuffer object, without window and event loop.
+bool renderHeadless(int frames) {
+    resize(headlessContext.getWidth(), headlessContext.getHeight());
+    display(); // first frame: culling, level selection, driver warm-up
+    glFinish();
+
+    cg::benchmark::GPUTimer gpuTimer;
+    cg::benchmark::Timer cpuTimer;
+    gpuTimer.begin();
+    for (int frame = 0; frame < frames; frame++) {
+        display();
+    }
+    gpuTimer.end();
+    glFinish();
+    std::cout << "headless: " << glGetString(GL_RENDERER) << ", " << headlessContext.getWidth() << "x" << headlessContext.getHeight()
+        << ", " << frames << " frames  gpu " << gpuTimer.ms() / frames << " ms/frame  cpu " << cpuTimer.ms() / frames
+        << " ms/frame" << std::endl;
+
+    if (!headlessImage.empty() && !headlessContext.writePPM(headlessImage)) {
+        std::cerr << "Cannot write " << headlessImage << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool init() {
+    glClearColor(0.2, 0.2, 0.2, 1);
+    glEnable(GL_DEPTH_TEST);
+    view = glm::lookAt(glm::vec3(0.0f, 0.0f, 4.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    cg::GLSLProgram::setCompilerThreads();
+    if (!loadProgram(program, "shader/simple.vert", "shader/simple.frag") ||
+        !loadProgram(instancedProgram, "shader/instanced.vert", "shader/simple.frag") ||
+        !loadProgram(packedProgram, "shader/packed.vert", "shader/simple.frag") ||
+        !loadProgram(tessellatedProgram, "shader/tessellated.vert", "shader/simple.frag",
+                     "shader/tessellated.tesc", "shader/tessellated.tese")) {
+        return false;
+    }
+
+    cg::FrameConstants frame = { view, projection, projection * view };
+    frameConstants.update(frame);
+    frameConstants.bind(cg::FrameConstants::BINDING);
     sphere.init(recursionLevel);
+    tessellatedSphere.init();
+    grid = gridInstances(INSTANCE_GRID);
+    gridTree.build(grid);
+
+    std::vector<size_t> triangles;
+    for (int n = 0; n <= MAX_RECURSION_LEVEL; n++) {
+        triangles.push_back(cg::Icosphere::shared(MAX_RECURSION_LEVEL).level(n).indexCount / 3);
+    }
+    gridLod.setLevels(triangles);
+    gridLod.setTriangleBudget(TRIANGLE_BUDGET);
+    sphereLod.setLevels(triangles);
+    gridLod.setPixelsPerEdge(PIXELS_PER_EDGE);
+    sphereLod.setPixelsPerEdge(PIXELS_PER_EDGE);
     return true;
 }
 
 int main(int argc, char** argv) {
-    glutInit(&argc, argv);
-    glutInitContextVersion(4, 3);
-    glutInitContextFlags(GLUT_FORWARD_COMPATIBLE | GLUT_DEBUG);
-    glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
-    glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
-    glutCreateWindow("OpenGL Praktikum 2");
-    glutID = glutGetWindow();
+    // CPU rendering and CPU only benchmarks, no window and no GPU needed
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "--software" || arg.compare(0, 11, "--software=") == 0) {
+            return renderSoftware(arg.size() > 11 ? arg.substr(11) : "sphere.ppm") ? 0 : -1;
+        }
+        if (arg == "--bench-raster") {
+            cg::benchmark::softwareRasterizer();
+            return 0;
+        }
+        if (arg == "--bench-cull") {
+            cg::benchmark::frustumCulling();
+            return 0;
+        }
+        if (arg == "--bench-bvh") {
+            cg::benchmark::boundingVolumeHierarchy();
+            return 0;
+        }
+        if (arg == "--bench-icosphere") {
+            cg::benchmark::icosphereBuild();
+            return 0;
+        }
+        if (arg == "--bench-spheres") {
+            cg::benchmark::sphereGeneration();
+            return 0;
+        }
+        if (arg == "--bench-vertex-cache") {
+            cg::benchmark::vertexCache();
+            return 0;
+        }
+        if (arg == "--bench-packing") {
+            cg::benchmark::vertexPacking();
+            return 0;
+        }
+        if (arg == "--bench-meshlets") {
+            cg::benchmark::meshletCulling();
+            return 0;
+        }
+        if (arg == "--bench-load") {
+            cg::benchmark::shaderLoad("shader/simple.vert");
+            return 0;
+        }
+        if (arg == "--headless") {
+            headlessFrames = i + 1 < argc ? std::atoi(argv[++i]) : 0;
+            if (headlessFrames < 1) {
+                std::cerr << "--headless needs the number of frames" << std::endl;
+                return -1;
+            }
+        }
+        if (arg.compare(0, 17, "--headless-image=") == 0) {
+            headlessImage = arg.substr(17);
+        }
+    }
+
+    if (headlessFrames > 0) {
+        // no window and no X11 display: EGL, same GL version, GLEW initialized by create
+        if (!headlessContext.create(WINDOW_WIDTH, WINDOW_HEIGHT, 4, 3)) {
+            return -1;
+        }
+    }
+    else {
+        glutInit(&argc, argv);
+        glutInitContextVersion(4, 3);
+        glutInitContextFlags(GLUT_FORWARD_COMPATIBLE | GLUT_DEBUG);
+        glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
+        glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
+        glutCreateWindow("OpenGL Praktikum 2");
+        glutID = glutGetWindow();
+
+        if (glewInit() != GLEW_OK) {
+            return -1;
+        }
+    }
 
-    if (glewInit() != GLEW_OK) {
-        return -1;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--lattice") {
+            latticeSpheres = true;
+        }
+        if (std::string(argv[i]) == "--packed-vertices" || std::string(argv[i]) == "--packed-vertices=half") {
+            packVertices = true;
+            halfPositions = std::string(argv[i]) == "--packed-vertices=half";
+        }
+        if (std::string(argv[i]) == "--optimize-meshes") {
+            optimizeMeshes = true;
+        }
+        if (std::string(argv[i]) == "--meshlets") {
+            meshletCulling = true;
+        }
+        if (std::string(argv[i]) == "--bench-startup") {
+            cg::benchmark::programStartup("shader/simple.vert", "shader/simple.frag", SHADER_CACHE_DIR);
+            return 0;
+        }
+        if (std::string(argv[i]) == "--bench-compile") {
+            cg::benchmark::programCompile("shader/simple.vert", "shader/simple.frag");
+            return 0;
+        }
     }
 
     if (!init()) return -1;
 
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--bench-instancing") {
+            benchmarkInstancing(INSTANCE_GRID);
+            return 0;
+        }
+        if (std::string(argv[i]) == "--bench-tessellation") {
+            benchmarkTessellation();
+            return 0;
+        }
+        if (std::string(argv[i]) == "--bench-pool") {
+            cg::benchmark::geometryPool(instancedProgram);
+            return 0;
+        }
+    }
+
+    if (headlessFrames > 0) {
+        return renderHeadless(headlessFrames) ? 0 : -1;
+    }
+
     glutDisplayFunc(display);
     glutReshapeFunc(resize);
     glutKeyboardFunc(keyboard);
+    glutMouseFunc(mouse);
     glutMainLoop();
 
     return 0;
@@ -10,6 +10,11 @@
 
 #include "GLSLProgram.h"
 #include "GLTools.h"
+#include "VertexFormat.h"
+#include "Benchmark.h"
+#include "UniformBuffer.h"
+#include "GeometryPool.h"
+#include "GLState.h"
 
 // Standard window width
 const int WINDOW_WIDTH  = 640;
@@ -18,10 +23,11 @@ const int WINDOW_HEIGHT = 480;
 // GLUT window id/handle
 int glutID = 0;
 
-cg::GLSLProgram program;
+cg::GLSLProgram program; // shader/instanced.vert: position and size of every draw from its instance attribute
 
 glm::mat4x4 view;
 glm::mat4x4 projection;
+cg::UniformBuffer frameConstants; // view and projection, shared by all programs
 
 float zNear = 0.1f;
 float zFar  = 100.0f;
@@ -29,64 +35,34 @@ float zFar  = 100.0f;
 /*
  Struct to hold data for object rendering.
 */
-class Object
+struct Object
 {
-public:
-  inline Object ()
-    : vao(0),
-      positionBuffer(0),
-      colorBuffer(0),
-      indexBuffer(0)
-  {}
-
-  inline ~Object () { // GL context must exist on destruction
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &indexBuffer);
-    glDeleteBuffers(1, &colorBuffer);
-    glDeleteBuffers(1, &positionBuffer);
-  }
-
-  GLuint vao;        // vertex-array-object ID
-  
-  GLuint positionBuffer; // ID of vertex-buffer: position
-  GLuint colorBuffer;    // ID of vertex-buffer: color
-  
-  GLuint indexBuffer;    // ID of index-buffer
+  size_t mesh;        // in geometryPool
   
-  glm::mat4x4 model; // model matrix
+  glm::vec4 instance; // xyz: position, w: scale (instance attribute of shader/instanced.vert)
 };
 
 Object triangle;
 Object quad;
 
+// Layout of the interleaved vertices of all objects, and of their per-draw instance attribute.
+const cg::VertexFormat vertexFormat = cg::VertexFormat().add<glm::vec3>("position").add<glm::vec3>("color");
+const cg::VertexFormat instanceFormat = cg::VertexFormat().add<glm::vec4>("instance");
+
+// All objects in one vertex and one index buffer, drawn with one glMultiDrawElementsIndirect.
+// GL context must exist on destruction.
+cg::GeometryPool geometryPool(vertexFormat, instanceFormat);
+
 void renderTriangle()
 {
-  // Create mvp.
-  glm::mat4x4 mvp = projection * view * triangle.model;
-  
-  // Bind the shader program and set uniform(s).
-  program.use();
-  program.setUniform("mvp", mvp);
-  
-  // Bind vertex array object so we can render the 1 triangle.
-  glBindVertexArray(triangle.vao);
-  glDrawArrays(GL_TRIANGLES, 0, 3); // offset, size
-  glBindVertexArray(0);
+  // One command of the pool, drawn by flush.
+  geometryPool.draw(triangle.mesh, triangle.instance);
 }
 
 void renderQuad()
 {
-	// Create mvp.
-	glm::mat4x4 mvp = projection * view * quad.model;
-
-	// Bind the shader program and set uniform(s).
-	program.use();
-	program.setUniform("mvp", mvp);
-	
-	// Bind vertex array object so we can render the 1 triangle.
-	glBindVertexArray(quad.vao);
-	glDrawArrays(GL_TRIANGLES, 0, 6); // offset, size
-	glBindVertexArray(0);
+	// The 2 triangles of the quad.
+	geometryPool.draw(quad.mesh, quad.instance);
 }
 
 void initTriangle()
@@ -94,88 +70,39 @@ void initTriangle()
 	// Construct triangle. These vectors can go out of scope after we have send all data to the graphics card.
 	const std::vector<glm::vec3> vertices = { glm::vec3(-1.0f, 1.0f, 0.0f), glm::vec3(1.0f, -1.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f) };
 	const std::vector<glm::vec3> colors = { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) };
-	// no indices 
-
-	GLuint programId = program.getHandle();
-	GLuint pos;
-
-	// Step 0: Create vertex array object.
-	glGenVertexArrays(1, &triangle.vao);
-	glBindVertexArray(triangle.vao);
-
-	// Step 1: Create vertex buffer object for position attribute and bind it to the associated "shader attribute".
-	glGenBuffers(1, &triangle.positionBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, triangle.positionBuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_STATIC_DRAW);
-
-	// Bind it to position.
-	pos = glGetAttribLocation(programId, "position");
-	glEnableVertexAttribArray(pos);
-	glVertexAttribPointer(pos, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	// the pool draws indexed only: the trivial indices
+	const std::vector<uint32_t> indices = { 0, 1, 2 };
 
-	// Step 2: Create vertex buffer object for color attribute and bind it to...
-	glGenBuffers(1, &triangle.colorBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, triangle.colorBuffer);
-	glBufferData(GL_ARRAY_BUFFER, colors.size() * sizeof(glm::vec3), colors.data(), GL_STATIC_DRAW);
+	// Position and color interleaved (see vertexFormat), appended to the pool. Uploaded by initObjects.
+	triangle.mesh = geometryPool.add(vertexFormat.interleave(vertices, colors), indices);
 
-	// Bind it to color.
-	pos = glGetAttribLocation(programId, "color");
-	glEnableVertexAttribArray(pos);
-	glVertexAttribPointer(pos, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	// Position and scale.
+	triangle.instance = glm::vec4(-1.25f, 0.0f, 0.0f, 1.0f);
+}
 
-	// no Step 3
+void initQuad()
+{
+	// Construct quad. These vectors can go out of scope after we have send all data to the graphics card.
+	// 4 vertices, 6 indices
+	const std::vector<glm::vec3> vertices = { { -1.0f, 1.0f, 0.0f }, { -1.0, -1.0, 0.0 }, { 1.0f, -1.0f, 0.0f }, { 1.0f, 1.0f, 0.0f } };
+	const std::vector<glm::vec3> colors = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0, 1.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+	const std::vector<uint32_t> indices = { 0, 1, 2, 0, 2, 3 };
 
-	// Unbind vertex array object (back to default).
-	glBindVertexArray(0);
+	// Position and color interleaved, appended to the pool with the indices.
+	quad.mesh = geometryPool.add(vertexFormat.interleave(vertices, colors), indices);
 
-	// Modify model matrix.
-	triangle.model = glm::translate(glm::mat4(1.0f), glm::vec3(-1.25f, 0.0f, 0.0f));
+	// Position and scale.
+	quad.instance = glm::vec4(1.25f, 0.0f, 0.0f, 1.0f);
 }
 
-void initQuad()
+void initObjects()
 {
-	// Construct triangle. These vectors can go out of scope after we have send all data to the graphics card.
-        // 6 vertices
-	const std::vector<glm::vec3> vertices = { { -1.0f, 1.0f, 0.0f }, { -1.0, -1.0, 0.0 }, { 1.0f, -1.0f, 0.0f },
-						  { -1.0f, 1.0f, 0.0f }, { 1.0f, -1.0f, 0.0f }, { 1.0f, 1.0f, 0.0f } };
-	const std::vector<glm::vec3> colors = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0, 1.0f }, { 0.0f, 1.0f, 0.0f }, 
-						{ 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
-	// no indices
-
-	GLuint programId = program.getHandle();
-	GLuint pos;
-
-	// Step 0: Create vertex array object.
-	glGenVertexArrays(1, &quad.vao);
-	glBindVertexArray(quad.vao);
-
-	// Step 1: Create vertex buffer object for position attribute and bind it to the associated "shader attribute".
-	glGenBuffers(1, &quad.positionBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, quad.positionBuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_STATIC_DRAW);
-
-	// Bind it to position.
-	pos = glGetAttribLocation(programId, "position");
-	glEnableVertexAttribArray(pos);
-	glVertexAttribPointer(pos, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	// Step 2: Create vertex buffer object for color attribute and bind it to...
-	glGenBuffers(1, &quad.colorBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, quad.colorBuffer);
-	glBufferData(GL_ARRAY_BUFFER, colors.size() * sizeof(glm::vec3), colors.data(), GL_STATIC_DRAW);
-
-	// Bind it to color.
-	pos = glGetAttribLocation(programId, "color");
-	glEnableVertexAttribArray(pos);
-	glVertexAttribPointer(pos, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	// no Step 3
-
-	// Unbind vertex array object (back to default).
-	glBindVertexArray(0);
-
-	// Modify model matrix.
-	quad.model = glm::translate(glm::mat4(1.0f), glm::vec3(1.25f, 0.0f, 0.0f));
+	initTriangle();
+	initQuad();
+
+	// One vertex and one index buffer for all objects, smallest index type for the largest mesh
+	// (GL_UNSIGNED_BYTE), the VAO is bound to the attributes of the program.
+	geometryPool.upload(program);
 }
 
 /*
@@ -194,7 +121,7 @@ bool init()
 	view = glm::lookAt(eye, center, up);
 
 	// Create a shader program and set light direction.
-	if (!program.compileShaderFromFile("shader/simple.vert", cg::GLSLShader::VERTEX))
+	if (!program.compileShaderFromFile("shader/instanced.vert", cg::GLSLShader::VERTEX))
 	{
 		std::cerr << program.log();
 		return false;
@@ -212,9 +139,13 @@ bool init()
 		return false;
 	}
 
+	// Per-frame constants, the buffer stays bound.
+	program.bindUniformBlock("FrameConstants", cg::FrameConstants::BINDING);
+	frameConstants.update(cg::FrameConstants());
+	frameConstants.bind(cg::FrameConstants::BINDING);
+
 	// Create objects.
-	initTriangle();
-	initQuad();
+	initObjects();
 
 	return true;
 }
@@ -226,8 +157,17 @@ void render()
 {
 	glClear(GL_COLOR_BUFFER_BIT);
 
+	// Upload view and projection once for all objects.
+	cg::FrameConstants frame = { view, projection, projection * view };
+	frameConstants.update(frame);
+
+	// All objects with one draw call, their model matrix is their instance.
+	program.use();
+	program.setUniform("model", glm::mat4(1.0f));
+	geometryPool.begin();
 	renderTriangle();
 	renderQuad();
+	geometryPool.flush();
 }
 
 void glutDisplay ()
@@ -275,6 +215,19 @@ void glutKeyboard (unsigned char keycode, int x, int y)
 	case 'z':
 		// do something
 		break;
+	case 's':
+		{
+			// binds elided by the state shadow since the last 's'
+			const cg::GLState::Stats& state = cg::GLState::getStats();
+			std::cout << "GL state: " << state.calls << " binds, " << state.skipped << " elided, "
+				<< state.mismatches << " validation mismatches" << std::endl;
+			cg::GLState::resetStats();
+		}
+		break;
+	case 'b':
+		// separate vs. interleaved vertex buffers
+		cg::benchmark::vertexLayouts(program);
+		break;
 	}
 	glutPostRedisplay();
 }
@@ -333,7 +286,7 @@ int main(int argc, char** argv)
   glutMainLoop ();
   
   // Cleanup in destructors:
-  // Objects will be released in ~Object
+  // Objects will be released in ~GeometryPool
   // Shader program will be released in ~GLSLProgram
   
   return 0;
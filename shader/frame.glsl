@@ -0,0 +1,7 @@
+// Per-frame constants shared by all programs, uploaded once per frame (cg::FrameConstants).
+layout(std140) uniform FrameConstants
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+};
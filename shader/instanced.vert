@@ -0,0 +1,17 @@
+#version 330 core
+
+in vec3 position;
+in vec3 color;
+in vec4 instance; // per instance: xyz center, w radius
+
+#include "frame.glsl"
+
+uniform mat4 model; // of all instances
+
+out vec3 fragmentColor;
+
+void main()
+{
+	fragmentColor = color;
+	gl_Position   = viewProjection * model * vec4(position * instance.w + instance.xyz,  1.0);
+}
@@ -0,0 +1,21 @@
+#version 330 core
+
+in vec4 position; // unorm16 or half
+in vec2 normal;   // octahedral snorm16
+in vec4 color;    // unorm8
+in vec4 instance; // per instance: xyz center, w radius; (0, 0, 0, 1) without instances
+
+#include "frame.glsl"
+#include "packing.glsl"
+
+uniform mat4 model;
+
+out vec3 fragmentColor;
+
+void main()
+{
+	// head light
+	vec3 n = normalize(mat3(view * model) * octahedralDecode(normal));
+	fragmentColor = color.rgb * (0.25 + 0.75 * abs(n.z));
+	gl_Position   = viewProjection * model * vec4(unpackPosition(position) * instance.w + instance.xyz,  1.0);
+}
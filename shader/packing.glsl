@@ -0,0 +1,17 @@
+// Decoding of the cg::VertexPacking formats, the normalization itself is done by the vertex fetch.
+uniform vec3 positionScale;  // VertexPacking::Bounds::scale, 1 for half positions
+uniform vec3 positionOffset; // VertexPacking::Bounds::offset, 0 for half positions
+
+vec3 unpackPosition(vec4 position)
+{
+	return position.xyz * positionScale + positionOffset;
+}
+
+// [-1, 1]^2 to a unit vector, see VertexPacking::octahedral
+vec3 octahedralDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
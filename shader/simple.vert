@@ -3,12 +3,14 @@
 in vec3 position;
 in vec3 color;
 
-uniform mat4 mvp;
+#include "frame.glsl"
+
+uniform mat4 model;
 
 out vec3 fragmentColor;
 
 void main()
 {
 	fragmentColor = color;
-	gl_Position   = mvp * vec4(position,  1.0);
+	gl_Position   = viewProjection * model * vec4(position,  1.0);
 }
\ No newline at end of file
@@ -0,0 +1,10 @@
+#version 400 core
+
+in vec3 position; // icosahedron corner, unit length
+
+out vec3 controlPosition;
+
+void main()
+{
+	controlPosition = position;
+}